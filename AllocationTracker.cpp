@@ -0,0 +1,128 @@
+#include "AllocationTracker.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+namespace Flan {
+    namespace {
+        // Plain arrays of atomics, the tracker can't allocate itself
+        std::atomic<uint32_t> g_n_allocations[static_cast<size_t>(AllocSubsystem::count)]{};
+        std::atomic<size_t> g_n_bytes[static_cast<size_t>(AllocSubsystem::count)]{};
+        AllocationStats g_last_frame{};
+        std::atomic<bool> g_strict = false;
+        std::atomic<uint32_t> g_warmup_frames_left = 0;
+        thread_local AllocSubsystem t_subsystem = AllocSubsystem::other;
+        thread_local bool t_reporting = false;
+
+        void report(const size_t size) {
+            // Reporting itself mustn't be reported
+            if (t_reporting) return;
+            t_reporting = true;
+            printf("ERROR: %zu byte heap allocation (%s) in a steady-state frame, call stack:\n", size, AllocationTracker::subsystem_name(t_subsystem));
+#ifdef _WIN32
+            void* frames[16];
+            const USHORT n_frames = CaptureStackBackTrace(2, 16, frames, nullptr);
+            for (USHORT i = 0; i < n_frames; ++i) {
+                printf("    %p\n", frames[i]);
+            }
+#else
+            printf("    (not available on this platform)\n");
+#endif
+            t_reporting = false;
+        }
+    }
+
+    bool AllocationTracker::enabled() {
+#ifdef FLAN_TRACK_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void AllocationTracker::end_frame() {
+        AllocationStats stats{};
+        for (size_t i = 0; i < static_cast<size_t>(AllocSubsystem::count); ++i) {
+            stats.n_allocations[i] = g_n_allocations[i].exchange(0);
+            stats.n_bytes[i] = g_n_bytes[i].exchange(0);
+            stats.total_allocations += stats.n_allocations[i];
+            stats.total_bytes += stats.n_bytes[i];
+        }
+        g_last_frame = stats;
+
+        uint32_t frames_left = g_warmup_frames_left.load();
+        if (frames_left > 0) g_warmup_frames_left.compare_exchange_strong(frames_left, frames_left - 1);
+    }
+
+    const AllocationStats& AllocationTracker::last_frame() {
+        return g_last_frame;
+    }
+
+    void AllocationTracker::set_strict(const bool strict, const uint32_t warmup_frames) {
+        g_warmup_frames_left = warmup_frames;
+        g_strict = strict;
+    }
+
+    void AllocationTracker::record(const size_t size) {
+        const auto subsystem = static_cast<size_t>(t_subsystem);
+        g_n_allocations[subsystem].fetch_add(1, std::memory_order_relaxed);
+        g_n_bytes[subsystem].fetch_add(size, std::memory_order_relaxed);
+        if (g_strict.load(std::memory_order_relaxed) && g_warmup_frames_left.load(std::memory_order_relaxed) == 0) report(size);
+    }
+
+    const char* AllocationTracker::subsystem_name(const AllocSubsystem subsystem) {
+        switch (subsystem) {
+        case AllocSubsystem::ecs: return "ecs";
+        case AllocSubsystem::values: return "values";
+        case AllocSubsystem::renderer: return "renderer";
+        case AllocSubsystem::text: return "text";
+        default: return "other";
+        }
+    }
+
+#ifdef FLAN_TRACK_ALLOCATIONS
+    AllocationScope::AllocationScope(const AllocSubsystem subsystem) : m_previous(t_subsystem) {
+        t_subsystem = subsystem;
+    }
+
+    AllocationScope::~AllocationScope() {
+        t_subsystem = m_previous;
+    }
+#endif
+}
+
+#ifdef FLAN_TRACK_ALLOCATIONS
+// Replacements for the global allocation functions. The nothrow and array versions that aren't here forward to these by default
+void* operator new(const size_t size) {
+    Flan::AllocationTracker::record(size);
+    if (void* ptr = malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new(const size_t size, const std::align_val_t alignment) {
+    Flan::AllocationTracker::record(size);
+    if (void* ptr = _aligned_malloc(size ? size : 1, static_cast<size_t>(alignment))) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    _aligned_free(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+    _aligned_free(ptr);
+}
+#endif
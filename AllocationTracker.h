@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Frames to skip before strict mode starts reporting, so startup and the first layout passes can fill their caches
+#define ALLOC_STRICT_WARMUP_FRAMES 60
+
+namespace Flan {
+    // Who an allocation is charged to. Set with AllocationScope, anything outside a scope counts as other
+    enum class AllocSubsystem : uint8_t {
+        other,
+        ecs,      // Entities and component pools
+        values,   // ValuePool slots
+        renderer, // Draw item queues, caches and layers
+        text,     // Text layout
+        count,
+    };
+
+    struct AllocationStats {
+        uint32_t n_allocations[static_cast<size_t>(AllocSubsystem::count)]{};
+        size_t n_bytes[static_cast<size_t>(AllocSubsystem::count)]{};
+        uint32_t total_allocations = 0;
+        size_t total_bytes = 0;
+    };
+
+    // Counts heap allocations per frame and per subsystem, by replacing the global operator new. Only active when built with FLAN_TRACK_ALLOCATIONS,
+    // otherwise the counts stay zero and the scopes compile to nothing. In strict mode every allocation after the warmup is reported with its call stack,
+    // to keep allocations out of the steady-state frame
+    class AllocationTracker {
+    public:
+        [[nodiscard]] static bool enabled();
+
+        // Publish the counts of the frame that just ended and start counting the next one. Renderer::begin_frame() calls this
+        static void end_frame();
+        [[nodiscard]] static const AllocationStats& last_frame();
+
+        static void set_strict(bool strict, uint32_t warmup_frames = ALLOC_STRICT_WARMUP_FRAMES);
+
+        // Called by operator new
+        static void record(size_t size);
+
+        [[nodiscard]] static const char* subsystem_name(AllocSubsystem subsystem);
+    };
+
+    // Charges the allocations in its lifetime to a subsystem, on this thread
+    class AllocationScope {
+    public:
+#ifdef FLAN_TRACK_ALLOCATIONS
+        explicit AllocationScope(AllocSubsystem subsystem);
+        ~AllocationScope();
+        AllocationScope(const AllocationScope&) = delete;
+        AllocationScope& operator=(const AllocationScope&) = delete;
+
+    private:
+        AllocSubsystem m_previous;
+#else
+        explicit AllocationScope(AllocSubsystem) {}
+#endif
+    };
+}
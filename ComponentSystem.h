@@ -2,6 +2,7 @@
 #include <vector>
 #include <cassert>
 
+#include "AllocationTracker.h"
 #include "ValueSystem.h"
 
 #define MAX_ENTITIES 1024
@@ -109,6 +110,7 @@ namespace Flan {
 namespace Flan {
     template <typename T>
     void Scene::add_component(EntityID entity, T comp) {
+        AllocationScope scope(AllocSubsystem::ecs);
         auto comp_id = get_comp_id<T>();
         // Set the component flag for this component
         _entities[entity] |= 1ull << comp_id;
@@ -130,6 +132,7 @@ namespace Flan {
 
     template <typename T>
     void Scene::add_component(const EntityID entity) {
+        AllocationScope scope(AllocSubsystem::ecs);
         const uint64_t comp_id = get_comp_id<T>();
         // Set the component flag for this component
         _entities[entity] |= 1ull << comp_id;
@@ -194,6 +197,7 @@ namespace Flan {
     }
 
     inline EntityID Scene::new_entity() {
+        AllocationScope scope(AllocSubsystem::ecs);
         // Is there an empty spot in the entities list? If so, claim that one
         for (EntityID i = 0; i < _entities.size(); i++) {
             if (_entities[i] == 0) {
@@ -3,6 +3,7 @@
 #include <utility>
 #include <cmath>
 #include <algorithm>
+#include <bit>
 
 #include "ComponentSystem.h"
 #include "Input.h"
@@ -159,6 +160,161 @@ namespace Flan {
         std::function<void()> on_click;
     };
 
+    // Which render system a cache entry belongs to, every system caches its own geometry
+    enum class RenderPass {
+        sprite,
+        special,
+        text,
+        box,
+        count
+    };
+
+    // Retained geometry of an entity, only regenerated when something it depends on changes
+    struct RenderCache {
+        RenderCache() {
+            std::fill(std::begin(handles), std::end(handles), INVALID_CACHE_HANDLE);
+        }
+        uint32_t handles[static_cast<size_t>(RenderPass::count)];
+        uint64_t signatures[static_cast<size_t>(RenderPass::count)]{};
+    };
+
+    // FNV-1a hash of everything an entity's geometry depends on
+    struct SignatureHash {
+        uint64_t hash = 14695981039346656037ull;
+        void add_bytes(const void* data, const size_t size) {
+            const auto* bytes = static_cast<const uint8_t*>(data);
+            for (size_t i = 0; i < size; ++i) {
+                hash ^= bytes[i];
+                hash *= 1099511628211ull;
+            }
+        }
+        template <typename T>
+        void add(const T& value) {
+            add_bytes(&value, sizeof(T));
+        }
+        void add_string(const wchar_t* string) {
+            if (string) add_bytes(string, wcslen(string) * sizeof(wchar_t));
+        }
+    };
+
+    inline uint64_t entity_signature(Scene& scene, const EntityID entity) {
+        SignatureHash signature;
+        if (const auto* transform = scene.get_component<Transform>(entity)) {
+            signature.add(transform->top_left);
+            signature.add(transform->bottom_right);
+            signature.add(transform->depth);
+            signature.add(transform->anchor);
+        }
+        if (auto* value = scene.get_component<Value>(entity)) {
+            // Strings are stored as a pointer, and the text behind it can change without the pointer changing
+            signature.add(value->get_as_ref<uint64_t>());
+            if (value->type == VarType::wstring) signature.add_string(value->get_as_ptr<wchar_t>());
+        }
+        if (const auto* text = scene.get_component<Text>(entity)) {
+            signature.add_string(text->text);
+            signature.add(text->color);
+            signature.add(text->scale);
+            signature.add(text->margins);
+            signature.add(text->ui_anchor);
+            signature.add(text->text_anchor);
+        }
+        if (const auto* mouse_interact = scene.get_component<MouseInteract>(entity)) {
+            signature.add(mouse_interact->state);
+        }
+        if (const auto* multi_hitbox = scene.get_component<MultiHitbox>(entity)) {
+            signature.add(multi_hitbox->click_states);
+        }
+        if (const auto* box = scene.get_component<Box>(entity)) {
+            signature.add(box->color_inner);
+            signature.add(box->color_outer);
+            signature.add(box->thickness);
+        }
+        if (const auto* combobox = scene.get_component<Combobox>(entity)) {
+            signature.add(combobox->is_list_open);
+            signature.add(combobox->current_selected_index);
+            // The button shows the selected item's text. Sizes go in too, so moving characters between items changes the hash
+            signature.add(combobox->list_items.size());
+            for (const auto& item : combobox->list_items) {
+                signature.add(item.size());
+                signature.add_string(item.c_str());
+            }
+        }
+        if (const auto* radio_button = scene.get_component<RadioButton>(entity)) {
+            signature.add(radio_button->current_selected_index);
+        }
+        return signature.hash;
+    }
+
+    // Draw an entity's geometry for one render pass from its cache, and only call draw() to regenerate it when the signature changed.
+    // Entities without a RenderCache are drawn every frame
+    template <typename DrawFunction>
+    void draw_retained(Scene& scene, Renderer& renderer, const EntityID entity, const RenderPass pass, const uint64_t signature, DrawFunction&& draw) {
+        auto* cache = scene.get_component<RenderCache>(entity);
+        if (!cache) {
+            draw();
+            return;
+        }
+
+        const auto index = static_cast<size_t>(pass);
+        if (cache->signatures[index] == signature && renderer.draw_cached(cache->handles[index])) return;
+        renderer.begin_cache();
+        draw();
+        renderer.end_cache(cache->handles[index]);
+        cache->signatures[index] = signature;
+    }
+
+    // Rows of a scrollable list, cached in blocks. Scrolling only moves the blocks on the GPU, and a block is only generated when it comes into view or its rows change
+    #define SCROLL_VIEW_BLOCK_ROWS 16
+    struct ScrollView {
+        std::vector<uint32_t> block_handles;
+        std::vector<uint64_t> block_signatures;
+    };
+
+    // Draw the visible rows of a list between top_left and bottom_right, scrolled down by scroll pixels. draw_row(index, transform, top_left) draws a row,
+    // where the transform covers the row's block. row_signature(index, hash) adds everything a row's geometry depends on to the hash
+    template <typename RowSignature, typename DrawRow>
+    void draw_scroll_view(Renderer& renderer, ScrollView& view, const Transform& transform, const glm::vec2 top_left, const glm::vec2 bottom_right,
+                          const size_t n_rows, const float row_height, const float scroll, RowSignature&& row_signature, DrawRow&& draw_row) {
+        const float block_height = row_height * SCROLL_VIEW_BLOCK_ROWS;
+        const size_t n_blocks = (n_rows + SCROLL_VIEW_BLOCK_ROWS - 1) / SCROLL_VIEW_BLOCK_ROWS;
+        view.block_handles.resize(n_blocks, INVALID_CACHE_HANDLE);
+        view.block_signatures.resize(n_blocks, 0);
+        if (n_blocks == 0 || block_height <= 0.0f) return;
+
+        renderer.push_clip_rect(top_left, bottom_right, transform.anchor);
+        const auto first_block = static_cast<size_t>(std::max(scroll, 0.0f) / block_height);
+        const auto last_block = std::min(static_cast<size_t>(std::max(scroll + bottom_right.y - top_left.y, 0.0f) / block_height), n_blocks - 1);
+        for (size_t block = first_block; block <= last_block; ++block) {
+            // Every block is generated at the top of the view, and moved into place when it's drawn
+            const glm::vec2 offset = { 0.0f, static_cast<float>(block) * block_height - scroll };
+            const size_t first_row = block * SCROLL_VIEW_BLOCK_ROWS;
+            const size_t end_row = std::min(first_row + SCROLL_VIEW_BLOCK_ROWS, n_rows);
+
+            SignatureHash signature;
+            signature.add(top_left);
+            signature.add(bottom_right.x);
+            signature.add(row_height);
+            signature.add(transform.depth);
+            signature.add(transform.anchor);
+            for (size_t row = first_row; row < end_row; ++row) {
+                row_signature(row, signature);
+            }
+            if (view.block_signatures[block] == signature.hash && renderer.draw_scrolled(view.block_handles[block], offset)) continue;
+
+            Transform block_transform = transform;
+            block_transform.top_left = top_left;
+            block_transform.bottom_right = { bottom_right.x, top_left.y + block_height };
+            renderer.begin_scroll_content();
+            for (size_t row = first_row; row < end_row; ++row) {
+                draw_row(row, block_transform, top_left + glm::vec2(0.0f, static_cast<float>(row - first_row) * row_height));
+            }
+            renderer.end_scroll_content(view.block_handles[block]);
+            view.block_signatures[block] = signature.hash;
+            renderer.draw_scrolled(view.block_handles[block], offset);
+        }
+        renderer.pop_clip_rect();
+    }
+
     inline EntityID create_button(Scene& scene, 
         const Transform& transform,
         std::function<void()> func,
@@ -174,6 +330,7 @@ namespace Flan {
         scene.add_component<Text>(entity, text);
         scene.add_component<Button>(entity);
         scene.add_component<Box>(entity, { {0.7f, 0.7f, 0.7f, 0.7f}, {1, 1, 1, 1}, 2.0f });
+        scene.add_component<RenderCache>(entity);
         return entity;
     }
 
@@ -188,6 +345,7 @@ namespace Flan {
         scene.add_component<Transform>(entity, transform);
         scene.add_component<Text>(entity, text);
         scene.add_component<Value>(entity, { name, VarType::wstring, scene.value_pool });
+        scene.add_component<RenderCache>(entity);
         if (has_box)
             scene.add_component<Box>(entity);
 
@@ -218,6 +376,7 @@ namespace Flan {
         //scene.add_component<SpriteRender>(entity);
         scene.add_component<Text>(entity, text);
         scene.get_component<Value>(entity)->set<double>(range.default_value);
+        scene.add_component<RenderCache>(entity);
         return entity;
     }
 
@@ -238,6 +397,7 @@ namespace Flan {
         scene.add_component<WheelKnob>(entity);
         scene.add_component<Text>(entity, text);
         scene.get_component<Value>(entity)->set<double>(range.default_value);
+        scene.add_component<RenderCache>(entity);
         return entity;
     }
 
@@ -264,6 +424,7 @@ namespace Flan {
         scene.add_component<Scrollable>(entity);
         scene.add_component<MouseInteract>(entity);
         scene.add_component<Slider>(entity);
+        scene.add_component<RenderCache>(entity);
         if (has_text) {
             scene.add_component<Text>(entity, text);
         }
@@ -304,6 +465,7 @@ namespace Flan {
         scene.add_component<MultiHitbox>(entity, multihitbox);
         scene.add_component<RadioButton>(entity, {options, initial_index});
         scene.add_component<MouseInteract>(entity);
+        scene.add_component<RenderCache>(entity);
         return entity;
     }
 
@@ -342,6 +504,8 @@ namespace Flan {
         scene.add_component<MouseInteract>(entity);
         scene.add_component<MultiHitbox>(entity, multi_hitbox);
         scene.add_component<Combobox>(entity, combobox);
+        scene.add_component<RenderCache>(entity);
+        scene.add_component<ScrollView>(entity);
         return entity;
     }
 
@@ -353,6 +517,7 @@ namespace Flan {
         const EntityID entity = scene.new_entity();
         scene.add_component<Transform>(entity, transform);
         scene.add_component<Box>(entity, box);
+        scene.add_component<RenderCache>(entity);
         return entity;
     }
 
@@ -378,7 +543,9 @@ namespace Flan {
                     color *= 0.7f;
                 }
             }
-            renderer.draw_box_textured(*transform, sprite->sprites[0].tex_path, sprite->sprites[0].tex_type, transform->top_left, transform->bottom_right, color, transform->depth + 0.001f, transform->anchor);
+            draw_retained(scene, renderer, entity, RenderPass::sprite, entity_signature(scene, entity), [&] {
+                renderer.draw_box_textured(*transform, sprite->sprites[0].tex_path, sprite->sprites[0].tex_type, transform->top_left, transform->bottom_right, color, transform->depth + 0.001f, transform->anchor);
+            });
         }
     }
 
@@ -425,18 +592,19 @@ namespace Flan {
                 }
             }
 
-            // Calculate position relative to top_left
-            glm::vec2 transform_top_left = transform->top_left + text->margins;
-            glm::vec2 transform_bottom_right = transform->bottom_right - text->margins;
-            const glm::vec2 top_left = transform_top_left + glm::vec2(renderer.resolution()) * anchor_offsets[static_cast<size_t>(transform->anchor)];
-            const glm::vec2 offset_from_top_left = (transform_bottom_right - transform_top_left) * anchor_offsets[static_cast<size_t>(text->ui_anchor)];
-            if (!slider)
-                renderer.draw_text({ transform_top_left, transform_bottom_right, transform->depth, transform->anchor }, text->text, top_left + offset_from_top_left, text->scale, text->color, transform->depth, AnchorPoint::top_left, text->text_anchor);
-            else
-                renderer.draw_text({ {-9999, -9999}, {9999, 9999}, transform->depth, transform->anchor }, text->text, top_left + offset_from_top_left, text->scale, text->color, transform->depth, AnchorPoint::top_left, text->text_anchor);
+            draw_retained(scene, renderer, entity, RenderPass::text, entity_signature(scene, entity), [&] {
+                // Calculate position relative to top_left
+                glm::vec2 transform_top_left = transform->top_left + text->margins;
+                glm::vec2 transform_bottom_right = transform->bottom_right - text->margins;
+                const glm::vec2 offset_from_top_left = (transform_bottom_right - transform_top_left) * anchor_offsets[static_cast<size_t>(text->ui_anchor)];
+                if (!slider)
+                    renderer.draw_text({ transform_top_left, transform_bottom_right, transform->depth, transform->anchor }, text->text, transform_top_left + offset_from_top_left, text->scale, text->color, transform->depth, transform->anchor, text->text_anchor);
+                else
+                    renderer.draw_text({ {-9999, -9999}, {9999, 9999}, transform->depth, transform->anchor }, text->text, transform_top_left + offset_from_top_left, text->scale, text->color, transform->depth, transform->anchor, text->text_anchor);
 #ifdef _DEBUG
-            renderer.draw_circle_solid(*transform, top_left, { 4,4 }, { 1,0,1,1 });
+                renderer.draw_circle_solid(*transform, transform_top_left, { 4,4 }, { 1,0,1,1 }, 0.0f, transform->anchor);
 #endif
+            });
         }
     }
 
@@ -448,14 +616,16 @@ namespace Flan {
             auto* range = scene.get_component<NumberRange>(entity);
 
             // Draw the wheel
-            const glm::vec2 center = (transform->top_left + transform->bottom_right) / 2.0f;
-            const glm::vec2 scale = center - transform->top_left;
-            double& val = value->get_as_ref<double>();
-            const float angle = static_cast<float>(1.5 * 3.14159265359 + ((val - range->min) / (range->max - range->min) - 0.5) * (1.75 * 3.14159265359));
-            const glm::vec2 line_b = center + glm::vec2(cosf(angle), sinf(angle)) * scale;
-            renderer.draw_circle_solid(*transform, center, scale, { 1, 1, 1, 1 }, transform->depth + 0.0002f, transform->anchor);
-            renderer.draw_circle_line(*transform, center, scale, { 0, 0, 0, 1 }, 2, transform->depth + 0.0001f, transform->anchor);
-            renderer.draw_line(*transform, center, line_b, { 0, 0, 0, 1 }, 4, transform->depth + 0.0001f);
+            draw_retained(scene, renderer, entity, RenderPass::special, entity_signature(scene, entity), [&] {
+                const glm::vec2 center = (transform->top_left + transform->bottom_right) / 2.0f;
+                const glm::vec2 scale = center - transform->top_left;
+                double& val = value->get_as_ref<double>();
+                const float angle = static_cast<float>(1.5 * 3.14159265359 + ((val - range->min) / (range->max - range->min) - 0.5) * (1.75 * 3.14159265359));
+                const glm::vec2 line_b = center + glm::vec2(cosf(angle), sinf(angle)) * scale;
+                renderer.draw_circle_solid(*transform, center, scale, { 1, 1, 1, 1 }, transform->depth + 0.0002f, transform->anchor);
+                renderer.draw_circle_line(*transform, center, scale, { 0, 0, 0, 1 }, 2, transform->depth + 0.0001f, transform->anchor);
+                renderer.draw_line(*transform, center, line_b, { 0, 0, 0, 1 }, 4, transform->depth + 0.0001f);
+            });
         }
 
         // Sliders
@@ -467,27 +637,29 @@ namespace Flan {
             auto* draggable = scene.get_component<Draggable>(entity);
 
             // Draw the slider
-            glm::vec2 bottom_right = transform->bottom_right;
-            if (text && draggable && draggable->is_horizontal == false) {
-                bottom_right.y -= renderer.get_font_height() * text->scale.y;
-            }
-            const glm::vec2 center = (transform->top_left + bottom_right) / 2.0f;
-            const glm::vec2 scale = center - transform->top_left;
-            double& val = value->get_as_ref<double>();
-            float margin = 8;
-            if (draggable && draggable->is_horizontal)
-            {
-                const float dist_left = static_cast<float>(((val - range->min) / (range->max - range->min) - 0.5)) * 2 * (scale.x - margin);
-                renderer.draw_line(*transform, center + glm::vec2{ scale.x, 0 }, center - glm::vec2{ scale.x, 0 }, { 0, 0, 0, 1 }, 4, transform->depth + 0.0002f);
-                renderer.draw_line(*transform, center + glm::vec2{ scale.x, 0 }, center - glm::vec2{ scale.x, 0 }, { 1, 1, 1, 1 }, 2, transform->depth + 0.0001f);
-                renderer.draw_box_solid(*transform, center + glm::vec2{ dist_left - 10, -20 }, center + glm::vec2{ dist_left + 10, +20 }, { 1,1,1,1 });
-            }
-            else {
-                const float dist_bottom = static_cast<float>(((val - range->min) / (range->max - range->min) - 0.5)) * 2 * -(scale.y - margin);
-                renderer.draw_line(*transform, center + glm::vec2{0, scale.y}, center - glm::vec2{0, scale.y}, { 0, 0, 0, 1 }, 4, transform->depth + 0.0002f);
-                renderer.draw_line(*transform, center + glm::vec2{0, scale.y}, center - glm::vec2{0, scale.y}, { 1, 1, 1, 1 }, 2, transform->depth + 0.0001f);
-                renderer.draw_box_solid(*transform, center + glm::vec2{ -20, dist_bottom - 10 }, center + glm::vec2{ +20, dist_bottom + 10 }, { 1,1,1,1 });
-            }
+            draw_retained(scene, renderer, entity, RenderPass::special, entity_signature(scene, entity), [&] {
+                glm::vec2 bottom_right = transform->bottom_right;
+                if (text && draggable && draggable->is_horizontal == false) {
+                    bottom_right.y -= renderer.get_font_height() * text->scale.y;
+                }
+                const glm::vec2 center = (transform->top_left + bottom_right) / 2.0f;
+                const glm::vec2 scale = center - transform->top_left;
+                double& val = value->get_as_ref<double>();
+                float margin = 8;
+                if (draggable && draggable->is_horizontal)
+                {
+                    const float dist_left = static_cast<float>(((val - range->min) / (range->max - range->min) - 0.5)) * 2 * (scale.x - margin);
+                    renderer.draw_line(*transform, center + glm::vec2{ scale.x, 0 }, center - glm::vec2{ scale.x, 0 }, { 0, 0, 0, 1 }, 4, transform->depth + 0.0002f);
+                    renderer.draw_line(*transform, center + glm::vec2{ scale.x, 0 }, center - glm::vec2{ scale.x, 0 }, { 1, 1, 1, 1 }, 2, transform->depth + 0.0001f);
+                    renderer.draw_box_solid(*transform, center + glm::vec2{ dist_left - 10, -20 }, center + glm::vec2{ dist_left + 10, +20 }, { 1,1,1,1 });
+                }
+                else {
+                    const float dist_bottom = static_cast<float>(((val - range->min) / (range->max - range->min) - 0.5)) * 2 * -(scale.y - margin);
+                    renderer.draw_line(*transform, center + glm::vec2{0, scale.y}, center - glm::vec2{0, scale.y}, { 0, 0, 0, 1 }, 4, transform->depth + 0.0002f);
+                    renderer.draw_line(*transform, center + glm::vec2{0, scale.y}, center - glm::vec2{0, scale.y}, { 1, 1, 1, 1 }, 2, transform->depth + 0.0001f);
+                    renderer.draw_box_solid(*transform, center + glm::vec2{ -20, dist_bottom - 10 }, center + glm::vec2{ +20, dist_bottom + 10 }, { 1,1,1,1 });
+                }
+            });
         }
 
         // Radio buttons
@@ -499,42 +671,44 @@ namespace Flan {
             // Update the radio button current index
             radio_button->current_selected_index = static_cast<size_t>(value->get_as_ref<double>());
 
-            // Get some information ready for the sake of my mental sanity in writing this code
-            size_t n_options = radio_button->options.size();
-            float vertical_spacing = (transform->bottom_right.y - transform->top_left.y) / static_cast<float>(n_options);
-            float margin = 2.0f;
-            float circle_size_max = vertical_spacing / 2.0f - margin;
-            glm::vec2 circle_base_offset = transform->top_left + glm::vec2(margin + circle_size_max);
-            float outline_circle_radius = 20;
-            float selected_circle_radius = 14;
-            float text_margin = 20;
+            draw_retained(scene, renderer, entity, RenderPass::special, entity_signature(scene, entity), [&] {
+                // Get some information ready for the sake of my mental sanity in writing this code
+                size_t n_options = radio_button->options.size();
+                float vertical_spacing = (transform->bottom_right.y - transform->top_left.y) / static_cast<float>(n_options);
+                float margin = 2.0f;
+                float circle_size_max = vertical_spacing / 2.0f - margin;
+                glm::vec2 circle_base_offset = transform->top_left + glm::vec2(margin + circle_size_max);
+                float outline_circle_radius = 20;
+                float selected_circle_radius = 14;
+                float text_margin = 20;
             
-            // Display every option
-            for (size_t i = 0; i < n_options; ++i) {
-                // Determine a nice color based on what the mouse is doing
-                glm::vec4 color = { 1, 1, 1, 1 };
-                const auto* multi_hitbox = scene.get_component<MultiHitbox>(entity);
-                //if (multi_hitbox != nullptr && i == radio_button->current_selected_index) {
-                if (multi_hitbox != nullptr) {
-                    if (multi_hitbox->click_states[i] == ClickState::hover) {
-                        color *= 0.9f;
-                    }
-                    if (multi_hitbox->click_states[i] == ClickState::click) {
-                        color *= 0.7f;
+                // Display every option
+                for (size_t i = 0; i < n_options; ++i) {
+                    // Determine a nice color based on what the mouse is doing
+                    glm::vec4 color = { 1, 1, 1, 1 };
+                    const auto* multi_hitbox = scene.get_component<MultiHitbox>(entity);
+                    //if (multi_hitbox != nullptr && i == radio_button->current_selected_index) {
+                    if (multi_hitbox != nullptr) {
+                        if (multi_hitbox->click_states[i] == ClickState::hover) {
+                            color *= 0.9f;
+                        }
+                        if (multi_hitbox->click_states[i] == ClickState::click) {
+                            color *= 0.7f;
+                        }
                     }
-                }
 
-                // Draw the circle outline for each of them
-                renderer.draw_circle_line(*transform, circle_base_offset + glm::vec2(0, vertical_spacing * static_cast<float>(i)), glm::vec2(outline_circle_radius), color, 2.0f, transform->depth, transform->anchor);
+                    // Draw the circle outline for each of them
+                    renderer.draw_circle_line(*transform, circle_base_offset + glm::vec2(0, vertical_spacing * static_cast<float>(i)), glm::vec2(outline_circle_radius), color, 2.0f, transform->depth, transform->anchor);
 
-                // Draw the text
-                renderer.draw_text(*transform, radio_button->options[i], circle_base_offset + glm::vec2(0, vertical_spacing * static_cast<float>(i)) + glm::vec2(outline_circle_radius + text_margin, 0), { 2, 2 }, color, transform->depth, AnchorPoint::top_left, AnchorPoint::left);
+                    // Draw the text
+                    renderer.draw_text(*transform, radio_button->options[i], circle_base_offset + glm::vec2(0, vertical_spacing * static_cast<float>(i)) + glm::vec2(outline_circle_radius + text_margin, 0), { 2, 2 }, color, transform->depth, AnchorPoint::top_left, AnchorPoint::left);
 
-                // Draw selected circle
-                if (i == radio_button->current_selected_index) {
-                    renderer.draw_circle_solid(*transform, circle_base_offset + glm::vec2(0, vertical_spacing * static_cast<float>(i)), glm::vec2(selected_circle_radius), color, transform->depth, transform->anchor);
+                    // Draw selected circle
+                    if (i == radio_button->current_selected_index) {
+                        renderer.draw_circle_solid(*transform, circle_base_offset + glm::vec2(0, vertical_spacing * static_cast<float>(i)), glm::vec2(selected_circle_radius), color, transform->depth, transform->anchor);
+                    }
                 }
-            }
+            });
         }
 
         // Combobox
@@ -543,115 +717,122 @@ namespace Flan {
             auto* combobox = scene.get_component<Combobox>(entity);
             auto* multi_hitbox = scene.get_component<MultiHitbox>(entity);
             auto* value = scene.get_component<Value>(entity);
+            auto* scroll_view = scene.get_component<ScrollView>(entity);
 
-            // Determine a nice color based on what the mouse is doing
-            glm::vec4 top_color = { 1, 1, 1, 1 };
+            draw_retained(scene, renderer, entity, RenderPass::special, entity_signature(scene, entity), [&] {
+                // Determine a nice color based on what the mouse is doing
+                glm::vec4 top_color = { 1, 1, 1, 1 };
 
-            // todo: use actual color schemes instead of hard coded magic numbers
-            if (multi_hitbox->click_states[0] == ClickState::hover) {
-                top_color *= 0.9f;
-            }
-            if (multi_hitbox->click_states[0] == ClickState::click) {
-                top_color *= 0.7f;
-            }
+                // todo: use actual color schemes instead of hard coded magic numbers
+                if (multi_hitbox->click_states[0] == ClickState::hover) {
+                    top_color *= 0.9f;
+                }
+                if (multi_hitbox->click_states[0] == ClickState::click) {
+                    top_color *= 0.7f;
+                }
 
-            // Render the button
-            glm::vec2 box_top_left = transform->top_left;
-            glm::vec2 box_bottom_right = { transform->bottom_right.x, transform->top_left.y + combobox->button_height };
-            glm::vec2 arrow_center = { transform->bottom_right.x - 30.f, transform->top_left.y + (combobox->button_height / 2) + 8 };
-            glm::vec2 text_offset = { 8, (combobox->button_height / 2) };
-            glm::vec2 arrow_offset = { 16, -16 };
-            renderer.draw_box_solid(*transform, box_top_left, box_bottom_right, top_color, transform->depth + 0.01f, transform->anchor);
-            renderer.draw_box_line(*transform, box_top_left, box_bottom_right, { 0, 0, 0, 1 }, transform->depth, 0, transform->anchor);
-            if (combobox->current_selected_index != -1)
-                renderer.draw_text(*transform, combobox->list_items[combobox->current_selected_index], transform->top_left + text_offset, {2, 2}, {0, 0, 0, 0}, transform->depth - 0.01f, transform->anchor, AnchorPoint::left);
-            else 
-                renderer.draw_text(*transform, L"<no item selected>", transform->top_left + text_offset, {2, 2}, {0, 0, 0, 0}, transform->depth - 0.01f, transform->anchor, AnchorPoint::left);
-            renderer.draw_line(*transform, arrow_center, arrow_center + arrow_offset * glm::vec2(+1, 1), {0, 0, 0, 1}, 2, transform->depth - 0.01f, transform->anchor);
-            renderer.draw_line(*transform, arrow_center, arrow_center + arrow_offset * glm::vec2(-1, 1), {0, 0, 0, 1}, 2, transform->depth - 0.01f, transform->anchor);
-
-            // Debug
+                // Render the button
+                glm::vec2 box_top_left = transform->top_left;
+                glm::vec2 box_bottom_right = { transform->bottom_right.x, transform->top_left.y + combobox->button_height };
+                glm::vec2 arrow_center = { transform->bottom_right.x - 30.f, transform->top_left.y + (combobox->button_height / 2) + 8 };
+                glm::vec2 text_offset = { 8, (combobox->button_height / 2) };
+                glm::vec2 arrow_offset = { 16, -16 };
+                renderer.draw_box_solid(*transform, box_top_left, box_bottom_right, top_color, transform->depth + 0.01f, transform->anchor);
+                renderer.draw_box_line(*transform, box_top_left, box_bottom_right, { 0, 0, 0, 1 }, transform->depth, 0, transform->anchor);
+                if (combobox->current_selected_index != -1)
+                    renderer.draw_text(*transform, combobox->list_items[combobox->current_selected_index], transform->top_left + text_offset, {2, 2}, {0, 0, 0, 0}, transform->depth - 0.01f, transform->anchor, AnchorPoint::left);
+                else 
+                    renderer.draw_text(*transform, L"<no item selected>", transform->top_left + text_offset, {2, 2}, {0, 0, 0, 0}, transform->depth - 0.01f, transform->anchor, AnchorPoint::left);
+                renderer.draw_line(*transform, arrow_center, arrow_center + arrow_offset * glm::vec2(+1, 1), {0, 0, 0, 1}, 2, transform->depth - 0.01f, transform->anchor);
+                renderer.draw_line(*transform, arrow_center, arrow_center + arrow_offset * glm::vec2(-1, 1), {0, 0, 0, 1}, 2, transform->depth - 0.01f, transform->anchor);
+
+                // Debug
 #ifdef _DEBUG
-            for (size_t i = 0; i < multi_hitbox->n_hitboxes; ++i) {
-                renderer.draw_box_line(*transform, transform->top_left + multi_hitbox->hitboxes[i].top_left, transform->top_left + multi_hitbox->hitboxes[i].bottom_right, {1, 1, 0, 1}, 2.0f);
-            }
+                for (size_t i = 0; i < multi_hitbox->n_hitboxes; ++i) {
+                    renderer.draw_box_line(*transform, transform->top_left + multi_hitbox->hitboxes[i].top_left, transform->top_left + multi_hitbox->hitboxes[i].bottom_right, {1, 1, 0, 1}, 2.0f);
+                }
 #endif
+            });
 
             // Render the list if necessary
-            size_t start_index = 0 + static_cast<size_t>(combobox->current_scroll_position / combobox->item_height);
-            size_t end_index = start_index + static_cast<size_t>(combobox->list_height / combobox->item_height) + 1;
-            if (abs(transform->bottom_right.y - transform->top_left.y - combobox->button_height) > 1.0f) {
-                for (size_t i = start_index; i <= end_index; ++i)
-                {
-                    // Stop if end of list was reached
-                    if (i >= combobox->list_items.size())
-                        break;
-
-                    // Get transform information
-                    box_top_left = transform->top_left + glm::vec2(0, combobox->button_height + (combobox->item_height * static_cast<float>(i)) - combobox->current_scroll_position);
-                    box_bottom_right = { transform->bottom_right.x, box_top_left.y + combobox->item_height };
-                    text_offset = { 8, combobox->item_height / 2.0f };
-
-                    // Determine a nice color based on what the mouse is doing
-                    glm::vec4 color = { 1, 1, 1, 1 };
+            if (!scroll_view || abs(transform->bottom_right.y - transform->top_left.y - combobox->button_height) <= 1.0f) continue;
+            const glm::vec2 list_top_left = transform->top_left + glm::vec2(0, combobox->button_height);
+            const glm::vec2 list_bottom_right = transform->bottom_right;
+
+            // The rows are cached, so scrolling doesn't regenerate them
+            draw_scroll_view(renderer, *scroll_view, *transform, list_top_left, list_bottom_right, combobox->list_items.size(), combobox->item_height, combobox->current_scroll_position,
+                [&](const size_t i, SignatureHash& signature) {
+                    signature.add_string(combobox->list_items[i].c_str());
+                    signature.add(static_cast<int>(i) == combobox->current_selected_index);
+                },
+                [&](const size_t i, const Transform& block_transform, const glm::vec2 box_top_left) {
+                    const glm::vec2 box_bottom_right = { transform->bottom_right.x, box_top_left.y + combobox->item_height };
+                    const glm::vec2 text_offset = { 8, combobox->item_height / 2.0f };
 
                     // If this is the currently selected entry, darken it a bit
+                    glm::vec4 color = { 1, 1, 1, 1 };
                     if (static_cast<int>(i) == combobox->current_selected_index) {
                         color *= 0.8f;
                     }
 
-                    // Create a hitbox for the current item
-                    Hitbox curr_item_hitbox{};
-                    curr_item_hitbox.top_left = renderer.apply_anchor_in_pixel_space(box_top_left, transform->anchor);
-                    curr_item_hitbox.bottom_right = renderer.apply_anchor_in_pixel_space(box_bottom_right, transform->anchor);
-
-                    // If the mouse is over it, change the color based on the mouse
-                    if (curr_item_hitbox.intersects(input.mouse_pos(MouseRelative::window))) {
-                        if (multi_hitbox->click_states[1] == ClickState::hover) {
-                            color *= 0.9f;
-                        }
-                        if (multi_hitbox->click_states[1] == ClickState::click) {
-                            // This is a bit cursed, but it'll have to do
-                            // We will actually update the combobox selected index in the rendering code, since we already do a ton of logic here to figure out where the mouse is anyway
-                            color *= 0.7f;
-                            combobox->current_selected_index = static_cast<int>(i);
-                            combobox->is_list_open = false;
-                            value->set<double>(static_cast<double>(i));
-                            break;
-                        }
-                    }
-
                     // Draw the boxes
-                    renderer.draw_box_solid(*transform, box_top_left + glm::vec2(+1, 0), box_bottom_right + glm::vec2(-1, -1), color, transform->depth + 0.03f, transform->anchor);
-                    renderer.draw_box_line(*transform, box_top_left, box_bottom_right, { 0, 0, 0, 1 }, transform->depth + 0.03f, 0, transform->anchor);
-                    renderer.draw_text(*transform, combobox->list_items[i], box_top_left + text_offset, { 2, 2 }, { 0, 0, 0, 1 }, transform->depth + 0.02f, transform->anchor, AnchorPoint::left);
-                }
+                    renderer.draw_box_solid(block_transform, box_top_left + glm::vec2(+1, 0), box_bottom_right + glm::vec2(-1, -1), color, transform->depth + 0.03f, transform->anchor);
+                    renderer.draw_box_line(block_transform, box_top_left, box_bottom_right, { 0, 0, 0, 1 }, transform->depth + 0.03f, 0, transform->anchor);
+                    renderer.draw_text(block_transform, combobox->list_items[i], box_top_left + text_offset, { 2, 2 }, { 0, 0, 0, 1 }, transform->depth + 0.02f, transform->anchor, AnchorPoint::left);
+                });
+
+            // The row under the mouse is darkened by a box on top of the cached rows, between the row's box and its text
+            const glm::vec2 list_top_left_pixels = renderer.apply_anchor_in_pixel_space(list_top_left, transform->anchor);
+            const Hitbox list_hitbox{ list_top_left_pixels, renderer.apply_anchor_in_pixel_space(list_bottom_right, transform->anchor) };
+            const glm::vec2 mouse_pos = input.mouse_pos(MouseRelative::window);
+            if (!list_hitbox.intersects(mouse_pos)) continue;
+            const auto i = static_cast<size_t>((mouse_pos.y - list_top_left_pixels.y + combobox->current_scroll_position) / combobox->item_height);
+            if (i >= combobox->list_items.size()) continue;
+
+            float darken = 0.0f;
+            if (multi_hitbox->click_states[1] == ClickState::hover) {
+                darken = 0.1f;
+            }
+            if (multi_hitbox->click_states[1] == ClickState::click) {
+                // This is a bit cursed, but it'll have to do
+                // We will actually update the combobox selected index in the rendering code, since we already know where the mouse is here anyway
+                darken = 0.3f;
+                combobox->current_selected_index = static_cast<int>(i);
+                combobox->is_list_open = false;
+                value->set<double>(static_cast<double>(i));
+            }
+            if (darken > 0.0f) {
+                const glm::vec2 row_top_left = list_top_left + glm::vec2(0, combobox->item_height * static_cast<float>(i) - combobox->current_scroll_position);
+                renderer.push_clip_rect(list_top_left, list_bottom_right, transform->anchor);
+                renderer.draw_box_solid(*transform, row_top_left + glm::vec2(+1, 0), glm::vec2(transform->bottom_right.x - 1, row_top_left.y + combobox->item_height - 1), { 0, 0, 0, darken }, transform->depth + 0.025f, transform->anchor);
+                renderer.pop_clip_rect();
             }
         }
-
         // Box
         for (const auto entity : scene.view<Transform, Box>()) {
             auto* transform = scene.get_component<Transform>(entity);
             auto* box = scene.get_component<Box>(entity);
             auto* mouse_interact = scene.get_component<MouseInteract>(entity);
 
-            // Hovering and clicking affects color
-            float multiply = 1.0f;
-            if (mouse_interact) {
-                switch (mouse_interact->state) {
-                case ClickState::hover:
-                    multiply = 0.8f;
-                    break;
-                case ClickState::click:
-                    multiply = 0.6f;
-                    break;
-                default:
-                    break;
+            draw_retained(scene, renderer, entity, RenderPass::box, entity_signature(scene, entity), [&] {
+                // Hovering and clicking affects color
+                float multiply = 1.0f;
+                if (mouse_interact) {
+                    switch (mouse_interact->state) {
+                    case ClickState::hover:
+                        multiply = 0.8f;
+                        break;
+                    case ClickState::click:
+                        multiply = 0.6f;
+                        break;
+                    default:
+                        break;
+                    }
                 }
-            }
 
-            renderer.draw_box_solid(*transform, transform->top_left, transform->bottom_right, box->color_inner * multiply, transform->depth + 0.001f, transform->anchor);
-            renderer.draw_box_line(*transform, transform->top_left, transform->bottom_right, box->color_outer, box->thickness, transform->depth, transform->anchor);
+                renderer.draw_box_solid(*transform, transform->top_left, transform->bottom_right, box->color_inner * multiply, transform->depth + 0.001f, transform->anchor);
+                renderer.draw_box_line(*transform, transform->top_left, transform->bottom_right, box->color_outer, box->thickness, transform->depth, transform->anchor);
+            });
         }
     }
     
@@ -775,6 +956,9 @@ namespace Flan {
 
                 // Handle changed variable, since we didn't use set
                 value->has_changed = (val != old_val);
+                if (value->has_changed) {
+                    scene.value_pool.notify_change(scene.value_pool.key(value->name), reinterpret_cast<uint64_t&>(val), std::bit_cast<uint64_t>(old_val));
+                }
 
                 // Make the mouse invisible
                 input.mouse_visible(false);
@@ -802,6 +986,9 @@ namespace Flan {
 
                 // Handle changed variable, since we didn't use set
                 value->has_changed = (val != old_val);
+                if (value->has_changed) {
+                    scene.value_pool.notify_change(scene.value_pool.key(value->name), reinterpret_cast<uint64_t&>(val), std::bit_cast<uint64_t>(old_val));
+                }
             }
         }
     }
@@ -841,7 +1028,7 @@ namespace Flan {
         }
     }
 
-    inline void system_comp_combobox(Scene& scene, const Input& input, const float delta_time, bool& combobox_handled) {
+    inline void system_comp_combobox(Scene& scene, Renderer& renderer, const Input& input, const float delta_time, bool& combobox_handled) {
         // Handle combobox
         for (const auto entity : scene.view<Transform, Value, Combobox, MultiHitbox>()) {
             auto* transform = scene.get_component<Transform>(entity);
@@ -905,6 +1092,15 @@ namespace Flan {
 
             // Interpolate towards the scroll
             combobox->current_scroll_position = std::lerp(combobox->current_scroll_position, combobox->target_scroll_position, 1.0f - pow(2.0f, -delta_time * 25.0f));
+
+            // Keep frames coming while it's animating. Once it's close enough, snap to the target so the animation actually ends
+            if (abs(transform->bottom_right.y - target_bottom) < 0.25f && abs(combobox->current_scroll_position - combobox->target_scroll_position) < 0.25f) {
+                transform->bottom_right.y = target_bottom;
+                combobox->current_scroll_position = combobox->target_scroll_position;
+            }
+            else {
+                renderer.request_frame();
+            }
         }
     }
 
@@ -919,9 +1115,15 @@ namespace Flan {
         // Handle clickable components
         system_comp_mouse_interact(scene, renderer, input);
 
+        // Everything that changes between mouse down and mouse up (like a whole drag) is one undo step
+        if (ValueHistory* history = scene.value_pool.history) {
+            if (input.mouse_down(0)) history->begin_gesture();
+            if (input.mouse_up(0)) history->end_gesture();
+        }
+
         // Handle comboboxes - special case: if a combobox is interacted with, don't handle any other ones
         bool combobox_handled = false;
-        system_comp_combobox(scene, input, delta_time, combobox_handled);
+        system_comp_combobox(scene, renderer, input, delta_time, combobox_handled);
 
         if (combobox_handled == false) {
             // Handle other mouse interactable components
@@ -931,6 +1133,19 @@ namespace Flan {
             system_comp_radio_buttons(scene, renderer, input);
         }
 
+        // Undo, presets and playback write the pool directly, so find the Values bound to the slots they changed. Sorted, so each Value is a binary search
+        if (!scene.value_pool.written_slots.empty()) {
+            auto& written = scene.value_pool.written_slots;
+            std::sort(written.begin(), written.end());
+            written.erase(std::unique(written.begin(), written.end()), written.end());
+            for (const auto entity : scene.view<Value>()) {
+                auto* value = scene.get_component<Value>(entity);
+                const uint64_t* slot = &value->get_as_ref<uint64_t>();
+                if (std::binary_search(written.begin(), written.end(), slot)) value->has_changed = true;
+            }
+            written.clear();
+        }
+
         // Handle value changes
         for (const auto entity : scene.view<Value, Function>()) {
             auto* value = scene.get_component<Value>(entity);
@@ -941,6 +1156,12 @@ namespace Flan {
             }
         }
 
+        // The systems drew before handling input, so changed values only show up next frame
+        if (scene.value_pool.changed) {
+            scene.value_pool.changed = false;
+            renderer.request_frame();
+        }
+
         // Debug
 #ifdef _DEBUG
         for (const auto entity : scene.view<Transform>()) {
@@ -0,0 +1,81 @@
+#include "DamageTracker.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "glm/common.hpp"
+
+namespace Flan {
+    static uint64_t mix(uint64_t hash, const uint64_t word) {
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+        return hash ^ (hash >> 32);
+    }
+
+    uint64_t hash_bytes(const void* data, const size_t size, const uint64_t seed) {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        uint64_t hash = mix(seed, size);
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            memcpy(&word, bytes + i, 8);
+            hash = mix(hash, word);
+        }
+
+        // Whatever is left over goes in one last word
+        if (i < size) {
+            uint64_t word = 0;
+            memcpy(&word, bytes + i, size - i);
+            hash = mix(hash, word);
+        }
+        return hash;
+    }
+
+    glm::ivec4 rect_union(const glm::ivec4& a, const glm::ivec4& b) {
+        if (rect_empty(a)) return b;
+        if (rect_empty(b)) return a;
+        return { glm::min(a.x, b.x), glm::min(a.y, b.y), glm::max(a.z, b.z), glm::max(a.w, b.w) };
+    }
+
+    glm::ivec4 rect_intersect(const glm::ivec4& a, const glm::ivec4& b) {
+        return { glm::max(a.x, b.x), glm::max(a.y, b.y), glm::min(a.z, b.z), glm::min(a.w, b.w) };
+    }
+
+    void DamageTracker::add(const uint64_t hash, const glm::ivec4& bounds) {
+        if (rect_empty(bounds)) return;
+        m_curr.push_back({ hash, bounds });
+    }
+
+    void DamageTracker::add_damage(const glm::ivec4& rect) {
+        m_extra = rect_union(m_extra, rect);
+    }
+
+    glm::ivec4 DamageTracker::end_frame(const glm::ivec2 resolution) {
+        std::sort(m_curr.begin(), m_curr.end(), [](const Footprint& a, const Footprint& b) { return a.hash < b.hash; });
+
+        // Walk both sorted lists at the same time. Every item that only shows up in one of them damages its bounds
+        glm::ivec4 damage = m_extra;
+        m_extra = {};
+        size_t prev = 0;
+        size_t curr = 0;
+        while (prev < m_prev.size() || curr < m_curr.size()) {
+            if (curr == m_curr.size() || (prev < m_prev.size() && m_prev[prev].hash < m_curr[curr].hash)) {
+                damage = rect_union(damage, m_prev[prev++].bounds);
+            }
+            else if (prev == m_prev.size() || m_curr[curr].hash < m_prev[prev].hash) {
+                damage = rect_union(damage, m_curr[curr++].bounds);
+            }
+            else {
+                ++prev;
+                ++curr;
+            }
+        }
+        if (m_full) {
+            damage = { 0, 0, resolution.x, resolution.y };
+            m_full = false;
+        }
+
+        m_prev.swap(m_curr);
+        m_curr.clear();
+        return rect_intersect(damage, { 0, 0, resolution.x, resolution.y });
+    }
+}
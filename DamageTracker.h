@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "glm/vec2.hpp"
+#include "glm/vec4.hpp"
+
+namespace Flan {
+    // Fast non-cryptographic hash over raw bytes, a machine word at a time
+    [[nodiscard]] uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0);
+
+    // Rectangles in window pixels from the top left: x0, y0, x1, y1 (exclusive). Anything with x1 <= x0 or y1 <= y0 is empty
+    [[nodiscard]] inline bool rect_empty(const glm::ivec4& rect) { return rect.z <= rect.x || rect.w <= rect.y; }
+    [[nodiscard]] glm::ivec4 rect_union(const glm::ivec4& a, const glm::ivec4& b);
+    [[nodiscard]] glm::ivec4 rect_intersect(const glm::ivec4& a, const glm::ivec4& b);
+
+    // Finds the part of the window that has to be redrawn, by comparing what every draw item covered this frame with the last one.
+    // Items are identified by a hash of their contents, so anything that appeared, disappeared, moved or changed damages the area it covers.
+    class DamageTracker {
+    public:
+        // Register a draw item. Bounds should already be clipped
+        void add(uint64_t hash, const glm::ivec4& bounds);
+
+        // Redraw the whole window next frame
+        void invalidate() { m_full = true; }
+
+        // Damage an area in the current frame, for changes the hashes can't see
+        void add_damage(const glm::ivec4& rect);
+
+        // Compare with the previous frame and start a new one. Returns the union of the damaged areas, which is empty if nothing changed
+        [[nodiscard]] glm::ivec4 end_frame(glm::ivec2 resolution);
+
+    private:
+        struct Footprint {
+            uint64_t hash;
+            glm::ivec4 bounds;
+        };
+        std::vector<Footprint> m_prev; // Sorted by hash
+        std::vector<Footprint> m_curr;
+        glm::ivec4 m_extra{};
+        bool m_full = true;
+    };
+}
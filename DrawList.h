@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "glm/vec2.hpp"
+#include "glm/vec4.hpp"
+#include "CommonStructs.h"
+#include "FrameArena.h"
+#include "RendererStructs.h"
+
+namespace Flan {
+    // Sizes of a draw list's arrays, to find what was appended after a certain point
+    struct ArraySizes {
+        size_t items, vertices, indices, instances;
+    };
+
+    // Everything one thread records during a frame. The main thread draws into the renderer's own list, other threads get one from
+    // begin_draw_list(), and end_frame() appends those to the main list sorted by their order, so the result doesn't depend on timing
+    struct DrawList {
+        std::vector<PackedVertex> vertices;
+        std::vector<uint16_t> indices;
+        std::vector<Instance> instances;
+        std::vector<DrawItem> draw_items;
+        std::vector<glm::ivec4> clip_rects; // Every scissor box used this frame, the draw items index into it
+        std::vector<glm::vec4> clip_stack;  // Pushed clip rectangles in window pixels, the bottom one is the window
+        glm::ivec4 draw_clip{};             // Scissor box for the geometry that's being generated
+        AnchorPoint draw_clip_anchor = AnchorPoint::top_left; // What draw_clip was relative to, so cached clip rectangles can follow it when the window is resized
+        ArraySizes cache_start{};           // Array sizes at begin_cache()
+        bool recording_cache = false;
+        bool used_placeholder = false;      // A texture that wasn't loaded yet was drawn since begin_cache()
+        uint32_t order = 0;
+        FrameArena arena; // Scratch memory that lives until the list is reused
+
+        // Scratch for the draw functions, kept around so they don't allocate every frame
+        std::vector<glm::vec2> stroke_points;
+        std::vector<glm::vec2> stroke_positions;
+        std::vector<uint16_t> stroke_indices;
+        std::vector<Vertex> polygon_scratch;
+        std::vector<GlyphCmd> glyph_scratch;
+
+        // Start recording a new frame, with only the window on the clip stack
+        void reset(const glm::ivec2 resolution) {
+            vertices.clear();
+            indices.clear();
+            instances.clear();
+            draw_items.clear();
+            clip_rects.clear();
+            clip_stack.assign(1, { 0.0f, 0.0f, static_cast<float>(resolution.x), static_cast<float>(resolution.y) });
+            recording_cache = false;
+            arena.reset();
+        }
+    };
+}
@@ -1,9 +1,12 @@
 #include <chrono>
+#include <memory>
+#include <vector>
 
 #include "ComponentsGUI.h"
 #include "ComponentSystem.h"
 #include "Input.h"
 #include "Renderer.h"
+#include "RendererTests.h"
 
 static std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
 static std::chrono::time_point<std::chrono::steady_clock> end = std::chrono::steady_clock::now();
@@ -16,11 +19,82 @@ static float calculate_delta_time()
     return delta.count();
 }
 
+#ifdef FLAN_BENCH
+// Times the bulk draw functions against drawing the same primitives one call at a time, headless, so only generating the geometry is measured
+#define BENCH_PRIMITIVES 10000
+#define BENCH_FRAMES 200
+
+template <typename DrawFunction>
+static void bench(Flan::Renderer& renderer, const char* name, DrawFunction&& draw)
+{
+    double total_ms = 0.0;
+    for (int frame = 0; frame < BENCH_FRAMES; ++frame) {
+        renderer.begin_frame();
+        const auto draw_start = std::chrono::steady_clock::now();
+        draw();
+        total_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - draw_start).count();
+        renderer.end_frame();
+    }
+    const double frame_ms = total_ms / BENCH_FRAMES;
+    printf("%-24s %8.3f ms/frame %8.1f ns/primitive\n", name, frame_ms, frame_ms * 1e6 / BENCH_PRIMITIVES);
+}
+
+static int run_benchmarks()
+{
+    Flan::Renderer renderer;
+    renderer.init_headless(std::make_unique<Flan::NullBackend>(), { 1280, 720 });
+#ifdef FLAN_SCALAR_PACKING
+    printf("Packing: scalar (FLAN_SCALAR_PACKING)\n");
+#else
+    printf("Packing: SSE2\n");
+#endif
+    const Flan::Transform transform({ 0, 0 }, { 1280, 720 });
+
+    // The same pseudo-random primitives every run, a few of them off screen so culling is exercised too
+    uint32_t seed = 12345;
+    const auto random = [&seed](const float range) {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / static_cast<float>(1 << 24) * range;
+    };
+    std::vector<Flan::RectCmd> rects(BENCH_PRIMITIVES);
+    std::vector<Flan::LineCmd> lines(BENCH_PRIMITIVES);
+    std::vector<Flan::GlyphCmd> glyphs(BENCH_PRIMITIVES);
+    for (size_t i = 0; i < BENCH_PRIMITIVES; ++i) {
+        const glm::vec2 pos = { random(1400.0f) - 60.0f, random(800.0f) - 40.0f };
+        const glm::vec4 color = { random(1.0f), random(1.0f), random(1.0f), 1.0f };
+        rects[i] = { pos, pos + glm::vec2(random(40.0f), random(40.0f)), color, 0.1f };
+        lines[i] = { pos, pos + glm::vec2(random(80.0f) - 40.0f, random(80.0f) - 40.0f), color, 1.0f + random(3.0f), 0.1f };
+        glyphs[i] = { pos, static_cast<uint32_t>('A' + i % 26) };
+    }
+
+    bench(renderer, "draw_box_solid x N", [&] {
+        for (const auto& rect : rects) renderer.draw_box_solid(transform, rect.top_left, rect.bottom_right, rect.color, rect.depth);
+    });
+    bench(renderer, "draw_rects", [&] { renderer.draw_rects(transform, rects); });
+    bench(renderer, "draw_line x N", [&] {
+        for (const auto& line : lines) renderer.draw_line(transform, line.a, line.b, line.color, line.width, line.depth);
+    });
+    bench(renderer, "draw_lines", [&] { renderer.draw_lines(transform, lines); });
+    bench(renderer, "draw_glyph_run x N", [&] {
+        for (const auto& glyph : glyphs) renderer.draw_glyph_run(transform, { &glyph, 1 }, { 2, 2 }, { 1, 1, 1, 1 }, 0.1f);
+    });
+    bench(renderer, "draw_glyph_run", [&] { renderer.draw_glyph_run(transform, glyphs, { 2, 2 }, { 1, 1, 1, 1 }, 0.1f); });
+    return 0;
+}
+#endif
+
 int main()
 {
+#if defined(FLAN_TEST)
+    return Flan::run_renderer_tests();
+#elif defined(FLAN_BENCH)
+    return run_benchmarks();
+#else
     Flan::Renderer renderer;
     Flan::Scene scene;
     renderer.init();
+    renderer.set_frame_mode(Flan::FrameMode::on_demand); // Only draw when something happens
+    renderer.set_render_thread(true); // Draw and present on another thread while the next frame is generated
     Flan::Input input(renderer.window());
 
     // Create button
@@ -61,7 +135,7 @@ int main()
 
     float smooth_dt = 0.0f;
     [[maybe_unused]] float time = 0.0f;
-    wchar_t frametime_text[512];
+    wchar_t frametime_text[1024];
 
     while (!glfwWindowShouldClose(renderer.window())) {
         // Draw
@@ -69,7 +143,7 @@ int main()
         const float dt = calculate_delta_time();
         time += dt;
         smooth_dt = smooth_dt + (dt - smooth_dt) * (1.f-powf(0.02f, dt));
-        swprintf_s(frametime_text, L"frametime: %.5f ms\nframe rate: %.3f fps\nmouse_pos_absolute: %.0f, %.0f\nmouse_pos_window: %.0f, %.0f\nmouse_pos_relative: %.0f, %.0f\nmouse_buttons = %i%i%i\nmouse_down = %i%i%i\nmouse_up = %i%i%i\nmouse_wheel = %.0f\ndebug_numberbox = %f\ndebug_radio_button = %f\ndebug_combobox = %f\n",
+        swprintf_s(frametime_text, L"frametime: %.5f ms\nframe rate: %.3f fps\nmouse_pos_absolute: %.0f, %.0f\nmouse_pos_window: %.0f, %.0f\nmouse_pos_relative: %.0f, %.0f\nmouse_buttons = %i%i%i\nmouse_down = %i%i%i\nmouse_up = %i%i%i\nmouse_wheel = %.0f\ndebug_numberbox = %f\ndebug_radio_button = %f\ndebug_combobox = %f\ndraw calls: %u\nvertices: %u\nbytes uploaded: %zu\nallocations: %u (%zu bytes)\n  ecs %u, values %u, renderer %u, text %u, other %u\n",
             smooth_dt * 1000.f, 
             1.0f/smooth_dt, 
             input.mouse_pos(Flan::MouseRelative::absolute).x, 
@@ -84,7 +158,17 @@ int main()
             input.mouse_wheel(),
             scene.value_pool.get<double>("debug_numberbox"),
             scene.value_pool.get<double>("debug_radio_button"),
-            scene.value_pool.get<double>("debug_combobox")
+            scene.value_pool.get<double>("debug_combobox"),
+            renderer.stats().n_draw_calls,
+            renderer.stats().n_vertices,
+            renderer.stats().n_bytes_uploaded,
+            Flan::AllocationTracker::last_frame().total_allocations,
+            Flan::AllocationTracker::last_frame().total_bytes,
+            Flan::AllocationTracker::last_frame().n_allocations[static_cast<size_t>(Flan::AllocSubsystem::ecs)],
+            Flan::AllocationTracker::last_frame().n_allocations[static_cast<size_t>(Flan::AllocSubsystem::values)],
+            Flan::AllocationTracker::last_frame().n_allocations[static_cast<size_t>(Flan::AllocSubsystem::renderer)],
+            Flan::AllocationTracker::last_frame().n_allocations[static_cast<size_t>(Flan::AllocSubsystem::text)],
+            Flan::AllocationTracker::last_frame().n_allocations[static_cast<size_t>(Flan::AllocSubsystem::other)]
         );
         scene.value_pool.set_ptr("debug_text", &frametime_text);
         Flan::update_entities(scene, renderer, input, dt);
@@ -92,4 +176,5 @@ int main()
         renderer.end_frame();
         input.update(renderer.window());
     }
+#endif
 }
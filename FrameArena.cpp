@@ -0,0 +1,36 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+
+namespace Flan {
+    void FrameArena::reset() {
+        // Grow to whatever the last frame needed, with some headroom so a slowly growing frame doesn't reallocate every time
+        const size_t needed = m_cursor + m_overflow_bytes;
+        m_high_water_mark = std::max(m_high_water_mark, needed);
+        if (m_size == 0 || needed > m_size) {
+            m_size = std::max<size_t>({ m_size * 2, needed + needed / 2, FRAME_ARENA_INITIAL_SIZE });
+            m_block = std::make_unique<std::byte[]>(m_size);
+        }
+        m_overflow.clear();
+        m_overflow_bytes = 0;
+        m_cursor = 0;
+        m_n_heap_allocations = 0;
+    }
+
+    void* FrameArena::alloc(const size_t size, const size_t alignment) {
+        // Bump the cursor if it fits
+        const auto base = reinterpret_cast<uintptr_t>(m_block.get());
+        const size_t offset = (base + m_cursor + alignment - 1) / alignment * alignment - base;
+        if (m_block && offset + size <= m_size) {
+            m_cursor = offset + size;
+            return m_block.get() + offset;
+        }
+
+        // Otherwise fall back to the heap for the rest of the frame, and remember how much was missing
+        auto& block = m_overflow.emplace_back(std::make_unique<std::byte[]>(size + alignment));
+        m_overflow_bytes += size + alignment;
+        m_n_heap_allocations++;
+        const auto address = reinterpret_cast<uintptr_t>(block.get());
+        return block.get() + ((address + alignment - 1) / alignment * alignment - address);
+    }
+}
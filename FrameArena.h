@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Size of the arena before the first frame has shown how much it needs
+#define FRAME_ARENA_INITIAL_SIZE (64 * 1024)
+
+namespace Flan {
+    // Linear allocator for scratch memory that only lives until the end of the frame. Allocating is a pointer bump, and reset() frees everything at once.
+    // When a frame needs more than the arena has, the extra allocations come from the heap, and the next reset() grows the arena to that frame's
+    // high-water mark. After that, frames that need the same amount don't touch the heap at all.
+    class FrameArena {
+    public:
+        // Start a new frame. Everything allocated before this is invalid
+        void reset();
+
+        [[nodiscard]] void* alloc(size_t size, size_t alignment = alignof(std::max_align_t));
+
+        // Nothing is destroyed on reset(), so only trivially destructible types are allowed. The elements are value-initialized
+        template <typename T>
+        [[nodiscard]] std::span<T> alloc_array(const size_t count) {
+            static_assert(std::is_trivially_destructible_v<T>);
+            T* data = static_cast<T*>(alloc(count * sizeof(T), alignof(T)));
+            for (size_t i = 0; i < count; ++i) new (data + i) T();
+            return { data, count };
+        }
+
+        [[nodiscard]] size_t capacity() const { return m_size; }
+        [[nodiscard]] size_t high_water_mark() const { return m_high_water_mark; }
+        [[nodiscard]] size_t n_heap_allocations() const { return m_n_heap_allocations; } // Since the last reset()
+
+    private:
+        std::unique_ptr<std::byte[]> m_block;
+        size_t m_size = 0;
+        size_t m_cursor = 0;
+        std::vector<std::unique_ptr<std::byte[]>> m_overflow; // Heap allocations made this frame because the arena was full
+        size_t m_overflow_bytes = 0;
+        size_t m_high_water_mark = 0;
+        size_t m_n_heap_allocations = 0;
+    };
+}
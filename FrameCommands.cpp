@@ -0,0 +1,34 @@
+#include "FrameCommands.h"
+
+namespace Flan {
+    uint64_t sort_key(const DrawItem& item, const PackedVertex* vertices, const Instance* instances) {
+        // Anything that isn't fully opaque everywhere has to be blended: antialiased shapes, textures, and colors with alpha
+        bool translucent = false;
+        int16_t depth = 0;
+        if (item.type == BatchType::instances) {
+            depth = instances[item.first_vertex].depth;
+            for (uint32_t i = item.first_vertex; i < item.first_vertex + item.n_vertices && !translucent; i++) {
+                translucent = instances[i].kind != InstanceKind::rect || (instances[i].color >> 24) != 255;
+            }
+        }
+        else {
+            depth = vertices[item.first_vertex].depth;
+            for (uint32_t i = item.first_vertex; i < item.first_vertex + item.n_vertices && !translucent; i++) {
+                translucent = (vertices[i].color >> 24) != 255;
+            }
+        }
+
+        // Opaque items go front to back, so the depth test rejects as many pixels as possible.
+        // Translucent items go back to front after all of them, so they blend over whatever is behind them
+        const uint64_t depth_key = translucent ? static_cast<uint64_t>(32767 - depth) : static_cast<uint64_t>(depth + 32768);
+        if (translucent) return uint64_t{ 1 } << 63 | depth_key << 47;
+
+        // Opaque items can be drawn in any order, so they're grouped by state. The clip goes in the bits below the texture, GLBackend::sort_draw_items() adds it.
+        // Texture names past the field would only share a key, get_batch() still compares the real ones
+        static_assert(SORT_KEY_CLIP_SHIFT + 16 == SORT_KEY_TEXTURE_SHIFT, "The clip field has to end where the texture field starts");
+        static_assert(SORT_KEY_TEXTURE_SHIFT + SORT_KEY_TEXTURE_BITS == 45, "The texture field has to end where the pipeline field starts");
+        return depth_key << 47
+            | static_cast<uint64_t>(item.type) << 45
+            | (static_cast<uint64_t>(item.texture) & ((uint64_t{ 1 } << SORT_KEY_TEXTURE_BITS) - 1)) << SORT_KEY_TEXTURE_SHIFT;
+    }
+}
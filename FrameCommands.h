@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "GL/glcorearb.h"
+#include "glm/vec2.hpp"
+#include "glm/vec4.hpp"
+#include "GeometryCache.h"
+#include "RendererStructs.h"
+
+namespace Flan {
+    // Sort key layout, from the top: translucent at bit 63, depth at 47..62, pipeline at 45..46, texture at 16..44, clip at 0..15.
+    // Translucent items only have the top two fields. The sort is stable, so at the same depth they stay in the order they were drawn, which is the order they blend in
+    #define SORT_KEY_CLIP_SHIFT 0
+    #define SORT_KEY_TEXTURE_SHIFT 16
+    #define SORT_KEY_TEXTURE_BITS 29
+
+    // Sort key of an item without the clip, from its geometry. Cache entries compute it once when they're stored, backends for everything else.
+    // The clip bits are left zero, so ORing in (clip & 0xFFFF) << SORT_KEY_CLIP_SHIFT for opaque items can't touch the rest
+    [[nodiscard]] uint64_t sort_key(const DrawItem& item, const PackedVertex* vertices, const Instance* instances);
+
+    // A layer that has to be rendered into its texture before the frame that shows it
+    struct LayerPass {
+        GLuint fbo;
+        glm::ivec4 rect;     // Window pixels covered by the texture: x0, y0, x1, y1 (exclusive)
+        uint32_t first_item; // Range in FrameCommands::layer_items
+        uint32_t n_items;
+    };
+
+    // Everything needed to draw one frame. end_frame() moves the frame's arrays in here, so the backend can submit it on the render thread
+    // without touching anything the main thread keeps writing to
+    struct FrameCommands {
+        std::vector<PackedVertex> vertices;
+        std::vector<uint16_t> indices;
+        std::vector<Instance> instances;
+        std::vector<DrawItem> draw_items;
+        std::vector<glm::ivec4> clip_rects; // The draw items of the frame and the layers index into it
+        std::vector<DrawItem> layer_items;
+        std::vector<LayerPass> layers;
+        CacheUploads cached_vertices; // Cache entries stored since the last frame that was submitted
+        CacheUploads cached_indices;
+        CacheUploads cached_instances;
+        glm::ivec2 resolution{};
+        glm::ivec4 damage{};
+        RenderStats stats; // The main thread fills in what it knows, submitting adds the draw calls
+    };
+}
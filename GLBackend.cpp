@@ -0,0 +1,437 @@
+#include "GLBackend.h"
+
+#include <algorithm>
+#include <cstring>
+#include <GL/gl3w.h>
+
+#include "DamageTracker.h"
+
+namespace Flan {
+    void GLCacheBuffer::init(const size_t element_size, const uint32_t capacity) {
+        m_element_size = element_size;
+        m_capacity = capacity;
+        glCreateBuffers(1, &m_id);
+        glNamedBufferStorage(m_id, static_cast<GLsizeiptr>(m_element_size * m_capacity), nullptr, GL_DYNAMIC_STORAGE_BIT);
+    }
+
+    void GLCacheBuffer::destroy() {
+        if (m_id) glDeleteBuffers(1, &m_id);
+        m_id = 0;
+    }
+
+    void GLCacheBuffer::apply(const CacheUploads& uploads) {
+        if (uploads.capacity > m_capacity) grow(uploads.capacity);
+
+        // glNamedBufferSubData is ordered after the draw calls that still use the old contents, so ranges can be reused right away
+        size_t data_offset = 0;
+        for (const CacheRange& range : uploads.ranges) {
+            const size_t size = range.size * m_element_size;
+            glNamedBufferSubData(m_id, static_cast<GLintptr>(range.offset * m_element_size), static_cast<GLsizeiptr>(size), uploads.data.data() + data_offset);
+            data_offset += size;
+        }
+    }
+
+    void GLCacheBuffer::grow(const uint32_t new_capacity) {
+        // Copy everything into a bigger buffer. Offsets stay the same
+        GLuint new_id = 0;
+        glCreateBuffers(1, &new_id);
+        glNamedBufferStorage(new_id, static_cast<GLsizeiptr>(m_element_size * new_capacity), nullptr, GL_DYNAMIC_STORAGE_BIT);
+        glCopyNamedBufferSubData(m_id, new_id, 0, 0, static_cast<GLsizeiptr>(m_element_size * m_capacity));
+        glDeleteBuffers(1, &m_id);
+        m_id = new_id;
+        m_capacity = new_capacity;
+    }
+
+    void GLBackend::init(GLFWwindow* window, const GLuint shader, const GLuint instance_shader) {
+        m_window = window;
+        m_shader = shader;
+        m_instance_shader = instance_shader;
+        glClearColor(0.1f, 0.1f, 0.2f, 1.0f);
+        glUseProgram(m_shader);
+
+        // Create the streams every frame's geometry is copied into
+        m_vertex_stream.init(1024 * 1024);
+        m_index_stream.init(256 * 1024);
+        m_instance_stream.init(256 * 1024);
+
+        // Retained geometry lives in buffers that are only updated when an entry is regenerated. They start out as big as the renderer's allocators
+        m_cached_vertices.init(sizeof(PackedVertex), CACHE_VERTICES);
+        m_cached_indices.init(sizeof(uint16_t), CACHE_INDICES);
+        m_cached_instances.init(sizeof(Instance), CACHE_INSTANCES);
+
+        // Every quad uses the same indices, so they only need to be uploaded once
+        std::vector<uint16_t> quad_indices(QUAD_INDEX_BUFFER_QUADS * 6);
+        for (size_t i = 0; i < QUAD_INDEX_BUFFER_QUADS; ++i) {
+            const auto base = static_cast<uint16_t>(i * 4);
+            quad_indices[i * 6 + 0] = base + 0;
+            quad_indices[i * 6 + 1] = base + 1;
+            quad_indices[i * 6 + 2] = base + 2;
+            quad_indices[i * 6 + 3] = base + 0;
+            quad_indices[i * 6 + 4] = base + 2;
+            quad_indices[i * 6 + 5] = base + 3;
+        }
+        glCreateBuffers(1, &m_quad_index_buffer);
+        glNamedBufferStorage(m_quad_index_buffer, static_cast<GLsizeiptr>(quad_indices.size() * sizeof(uint16_t)), quad_indices.data(), 0);
+
+        // Setup vertex array. The vertex stream is bound to binding 0 every frame, since its section offset changes every frame
+        glCreateVertexArrays(1, &m_vao);
+        glVertexArrayAttribFormat(m_vao, 0, 2, GL_SHORT, GL_FALSE, offsetof(PackedVertex, x));
+        glVertexArrayAttribFormat(m_vao, 1, 2, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(PackedVertex, u));
+        glVertexArrayAttribFormat(m_vao, 2, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(PackedVertex, color));
+        glVertexArrayAttribFormat(m_vao, 3, 1, GL_SHORT, GL_TRUE, offsetof(PackedVertex, depth));
+        glVertexArrayAttribIFormat(m_vao, 4, 1, GL_UNSIGNED_BYTE, offsetof(PackedVertex, anchor));
+        for (GLuint i = 0; i < 5; ++i) {
+            glVertexArrayAttribBinding(m_vao, i, 0);
+            glEnableVertexArrayAttrib(m_vao, i);
+        }
+
+        // Setup instance vertex array. Every instance advances binding 0 once, the vertices within an instance come from gl_VertexID
+        glCreateVertexArrays(1, &m_instance_vao);
+        glVertexArrayAttribFormat(m_instance_vao, 0, 4, GL_SHORT, GL_FALSE, offsetof(Instance, rect));
+        glVertexArrayAttribFormat(m_instance_vao, 1, 4, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(Instance, uv));
+        glVertexArrayAttribFormat(m_instance_vao, 2, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(Instance, color));
+        glVertexArrayAttribFormat(m_instance_vao, 3, 1, GL_SHORT, GL_TRUE, offsetof(Instance, depth));
+        glVertexArrayAttribIFormat(m_instance_vao, 4, 1, GL_UNSIGNED_BYTE, offsetof(Instance, kind));
+        glVertexArrayAttribFormat(m_instance_vao, 5, 1, GL_UNSIGNED_SHORT, GL_FALSE, offsetof(Instance, width));
+        glVertexArrayAttribFormat(m_instance_vao, 6, 1, GL_UNSIGNED_BYTE, GL_FALSE, offsetof(Instance, corner_radius));
+        glVertexArrayAttribFormat(m_instance_vao, 7, 4, GL_UNSIGNED_BYTE, GL_FALSE, offsetof(Instance, insets));
+        glVertexArrayAttribIFormat(m_instance_vao, 8, 1, GL_UNSIGNED_BYTE, offsetof(Instance, anchor));
+        for (GLuint i = 0; i < 9; ++i) {
+            glVertexArrayAttribBinding(m_instance_vao, i, 0);
+            glEnableVertexArrayAttrib(m_instance_vao, i);
+        }
+        glVertexArrayBindingDivisor(m_instance_vao, 0, 1);
+    }
+
+    void GLBackend::submit_frame(FrameCommands& frame) {
+        glFrontFace(GL_CCW);
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA); // The shaders output premultiplied alpha
+        glDisable(GL_CULL_FACE);
+        glProgramUniform2iv(m_shader, glGetUniformLocation(m_shader, "resolution"), 1, &frame.resolution.x);
+        glProgramUniform2iv(m_instance_shader, glGetUniformLocation(m_instance_shader, "resolution"), 1, &frame.resolution.x);
+        resize_frame_buffer(frame.resolution);
+
+        // Move on to the next section of the streams, and upload the cache entries that were stored since the last frame
+        m_vertex_stream.begin_frame();
+        m_index_stream.begin_frame();
+        m_instance_stream.begin_frame();
+        m_cached_vertices.apply(frame.cached_vertices);
+        m_cached_indices.apply(frame.cached_indices);
+        m_cached_instances.apply(frame.cached_instances);
+
+        // Layers are rendered into their textures before the frame that samples them
+        for (const LayerPass& pass : frame.layers) {
+            constexpr float clear_color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            constexpr float clear_depth = 1.0f;
+            glClearNamedFramebufferfv(pass.fbo, GL_COLOR, 0, clear_color);
+            glClearNamedFramebufferfv(pass.fbo, GL_DEPTH, 0, &clear_depth);
+            glBindFramebuffer(GL_FRAMEBUFFER, pass.fbo);
+            const std::span<const DrawItem> items(frame.layer_items.data() + pass.first_item, pass.n_items);
+            sort_draw_items(frame, items);
+            upload_draw_items(frame, items);
+            draw_batches(frame, pass.rect, pass.rect);
+            m_batches.clear();
+        }
+
+        // Draw into the offscreen frame buffer, which holds on to the last frame. Only the damaged part is cleared and redrawn
+        const glm::ivec2 res = frame.resolution;
+        const glm::ivec4& damage = frame.damage;
+        glBindFramebuffer(GL_FRAMEBUFFER, m_frame_fbo);
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(damage.x, res.y - damage.w, damage.z - damage.x, damage.w - damage.y);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        sort_draw_items(frame, frame.draw_items);
+        upload_draw_items(frame, frame.draw_items);
+        draw_batches(frame, damage, { 0, 0, res.x, res.y });
+        m_batches.clear();
+        frame.stats.n_bytes_uploaded += m_vertex_stream.used() + m_index_stream.used() + m_instance_stream.used();
+        m_vertex_stream.end_frame();
+        m_index_stream.end_frame();
+        m_instance_stream.end_frame();
+
+        // The back buffer's contents are undefined after a swap, so the whole frame is copied over
+        glBlitNamedFramebuffer(m_frame_fbo, 0, 0, 0, res.x, res.y, 0, 0, res.x, res.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glfwSwapBuffers(m_window);
+    }
+
+    void GLBackend::resize_frame_buffer(const glm::ivec2 resolution) {
+        if (m_frame_res == resolution || resolution.x <= 0 || resolution.y <= 0) return;
+        destroy_render_target(m_frame_fbo, m_frame_color, m_frame_depth);
+        create_render_target(resolution, m_frame_fbo, m_frame_color, m_frame_depth);
+        m_frame_res = resolution;
+    }
+
+    void GLBackend::create_render_target(const glm::ivec2 size, GLuint& fbo, GLuint& color, GLuint& depth) {
+        glCreateTextures(GL_TEXTURE_2D, 1, &color);
+        glTextureStorage2D(color, 1, GL_RGBA8, size.x, size.y);
+        glTextureParameteri(color, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTextureParameteri(color, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glCreateRenderbuffers(1, &depth);
+        glNamedRenderbufferStorage(depth, GL_DEPTH_COMPONENT24, size.x, size.y);
+        glCreateFramebuffers(1, &fbo);
+        glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, color, 0);
+        glNamedFramebufferRenderbuffer(fbo, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+        if (glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            printf("ERROR: Frame buffer is incomplete!\n");
+        }
+    }
+
+    void GLBackend::destroy_render_target(GLuint& fbo, GLuint& color, GLuint& depth) {
+        if (fbo) glDeleteFramebuffers(1, &fbo);
+        if (color) glDeleteTextures(1, &color);
+        if (depth) glDeleteRenderbuffers(1, &depth);
+        fbo = color = depth = 0;
+    }
+
+    void GLBackend::draw_batches(FrameCommands& frame, const glm::ivec4& limit, const glm::ivec4& target) {
+        // Map window pixels onto the render target, which covers the target rectangle of the window
+        const glm::ivec2 res = frame.resolution;
+        glViewport(-target.x, target.w - res.y, res.x, res.y);
+
+        // Bind this frame's sections of the vertex and instance streams
+        glVertexArrayVertexBuffer(m_vao, 0, m_vertex_stream.id(), static_cast<GLintptr>(m_vertex_stream.section_offset()), sizeof(PackedVertex));
+        glVertexArrayVertexBuffer(m_instance_vao, 0, m_instance_stream.id(), static_cast<GLintptr>(m_instance_stream.section_offset()), sizeof(Instance));
+
+        // Render the batches in sorted order. Each pipeline reads either this frame's stream or the geometry cache
+        bool vertices_cached = false;
+        bool instances_cached = false;
+        GLuint bound_index_buffer = 0;
+        GLuint bound_vao = 0;
+        glm::ivec4 bound_clip = { -1, -1, -1, -1 };
+        bool depth_write = true;
+        glDepthMask(GL_TRUE);
+        glEnable(GL_SCISSOR_TEST);
+
+        // Scrolled content is moved on the GPU
+        glm::vec2 bound_offset = { 0.0f, 0.0f };
+        const auto set_offset = [this](const glm::vec2 offset) {
+            glProgramUniform2f(m_shader, glGetUniformLocation(m_shader, "offset"), offset.x, offset.y);
+            glProgramUniform2f(m_instance_shader, glGetUniformLocation(m_instance_shader, "offset"), offset.x, offset.y);
+        };
+        set_offset(bound_offset);
+        for (const auto& batch : m_batches) {
+            const glm::ivec4 clip = rect_intersect(batch.clip, limit);
+            if (rect_empty(clip)) continue;
+            glBindTexture(GL_TEXTURE_2D, batch.texture);
+
+            // Translucent batches are tested against the opaque ones, but don't hide what's drawn behind them later
+            if (batch.translucent == depth_write) {
+                depth_write = !batch.translucent;
+                glDepthMask(depth_write ? GL_TRUE : GL_FALSE);
+            }
+
+            // Batches are split wherever the clip rectangle changes. glScissor counts from the bottom of the target
+            if (clip != bound_clip) {
+                glScissor(clip.x - target.x, target.w - clip.w, clip.z - clip.x, clip.w - clip.y);
+                bound_clip = clip;
+                frame.stats.n_scissor_changes++;
+            }
+            if (batch.offset != bound_offset) {
+                set_offset(batch.offset);
+                bound_offset = batch.offset;
+            }
+
+            // Switch between the vertex and instance pipelines
+            const GLuint vao = batch.type == BatchType::instances ? m_instance_vao : m_vao;
+            if (vao != bound_vao) {
+                glUseProgram(batch.type == BatchType::instances ? m_instance_shader : m_shader);
+                glBindVertexArray(vao);
+                bound_vao = vao;
+            }
+
+            if (batch.type == BatchType::instances) {
+                if (batch.cached != instances_cached) {
+                    if (batch.cached) glVertexArrayVertexBuffer(m_instance_vao, 0, m_cached_instances.id(), 0, sizeof(Instance));
+                    else glVertexArrayVertexBuffer(m_instance_vao, 0, m_instance_stream.id(), static_cast<GLintptr>(m_instance_stream.section_offset()), sizeof(Instance));
+                    instances_cached = batch.cached;
+                }
+                glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, batch.n_vertices, static_cast<GLuint>(batch.first_vertex));
+                frame.stats.n_draw_calls++;
+                frame.stats.n_instances += static_cast<uint32_t>(batch.n_vertices);
+                continue;
+            }
+
+            if (batch.cached != vertices_cached) {
+                if (batch.cached) glVertexArrayVertexBuffer(m_vao, 0, m_cached_vertices.id(), 0, sizeof(PackedVertex));
+                else glVertexArrayVertexBuffer(m_vao, 0, m_vertex_stream.id(), static_cast<GLintptr>(m_vertex_stream.section_offset()), sizeof(PackedVertex));
+                vertices_cached = batch.cached;
+            }
+
+            // Switch index buffers when the batch type changes
+            const GLuint index_buffer = batch.type == BatchType::quads ? m_quad_index_buffer : batch.cached ? m_cached_indices.id() : m_index_stream.id();
+            if (index_buffer != bound_index_buffer) {
+                glVertexArrayElementBuffer(m_vao, index_buffer);
+                bound_index_buffer = index_buffer;
+            }
+
+            if (batch.type == BatchType::quads) {
+                // The quad index buffer only covers so many quads, so bigger batches take multiple draw calls
+                for (GLsizei first = 0; first < batch.n_vertices; first += QUAD_INDEX_BUFFER_QUADS * 4) {
+                    const GLsizei n_verts = std::min<GLsizei>(batch.n_vertices - first, QUAD_INDEX_BUFFER_QUADS * 4);
+                    glDrawElementsBaseVertex(GL_TRIANGLES, n_verts / 4 * 6, GL_UNSIGNED_SHORT, nullptr, batch.first_vertex + first);
+                    frame.stats.n_draw_calls++;
+                    frame.stats.n_indices += static_cast<uint32_t>(n_verts / 4 * 6);
+                }
+            }
+            else {
+                const size_t index_offset = (batch.cached ? 0 : m_index_stream.section_offset()) + static_cast<size_t>(batch.first_index) * sizeof(uint16_t);
+                glDrawElementsBaseVertex(GL_TRIANGLES, batch.n_indices, GL_UNSIGNED_SHORT, reinterpret_cast<const void*>(index_offset), batch.first_vertex);
+                frame.stats.n_draw_calls++;
+                frame.stats.n_indices += static_cast<uint32_t>(batch.n_indices);
+            }
+            frame.stats.n_vertices += static_cast<uint32_t>(batch.n_vertices);
+        }
+        glDisable(GL_SCISSOR_TEST); // Otherwise clears and blits would be clipped too
+        glDepthMask(GL_TRUE);
+    }
+
+    // Stable least significant digit radix sort, a byte per pass. Passes where every key has the same byte are skipped
+    static void radix_sort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch) {
+        if (entries.empty()) return;
+
+        // Count all the bytes in a single pass over the keys
+        size_t histograms[8][256]{};
+        for (const auto& entry : entries) {
+            for (int pass = 0; pass < 8; ++pass) {
+                histograms[pass][(entry.key >> (pass * 8)) & 0xFF]++;
+            }
+        }
+
+        scratch.resize(entries.size());
+        for (int pass = 0; pass < 8; ++pass) {
+            size_t* histogram = histograms[pass];
+            if (histogram[(entries[0].key >> (pass * 8)) & 0xFF] == entries.size()) continue;
+
+            // Turn the counts into offsets, and scatter
+            size_t offset = 0;
+            for (size_t i = 0; i < 256; ++i) {
+                const size_t count = histogram[i];
+                histogram[i] = offset;
+                offset += count;
+            }
+            for (const auto& entry : entries) {
+                scratch[histogram[(entry.key >> (pass * 8)) & 0xFF]++] = entry;
+            }
+            entries.swap(scratch);
+        }
+    }
+
+    void GLBackend::sort_draw_items(FrameCommands& frame, const std::span<const DrawItem> items) {
+        m_sort_entries.resize(items.size());
+        for (size_t i = 0; i < items.size(); ++i) {
+            const DrawItem& item = items[i];
+            uint64_t key = item.cached ? item.key : sort_key(item, frame.vertices.data(), frame.instances.data());
+            if ((key >> 63) == 0) key |= static_cast<uint64_t>(item.clip & 0xFFFF) << SORT_KEY_CLIP_SHIFT; // Translucent items keep the order they were drawn in
+            m_sort_entries[i] = { key, static_cast<uint32_t>(i) };
+            frame.stats.n_translucent_items += static_cast<uint32_t>(key >> 63);
+            frame.stats.n_cached_items += item.cached ? 1 : 0;
+        }
+        frame.stats.n_draw_items += static_cast<uint32_t>(items.size());
+        radix_sort(m_sort_entries, m_sort_scratch);
+    }
+
+    void GLBackend::upload_draw_items(const FrameCommands& frame, const std::span<const DrawItem> items) {
+        // One allocation per stream for all the items. Layers upload their items separately, so count what's actually used
+        size_t n_vertices = 0;
+        size_t n_indices = 0;
+        size_t n_instances = 0;
+        for (const auto& item : items) {
+            if (item.cached) continue;
+            if (item.type == BatchType::instances) n_instances += item.n_vertices;
+            else n_vertices += item.n_vertices;
+            n_indices += item.n_indices;
+        }
+        size_t vertex_offset = 0;
+        size_t index_offset = 0;
+        size_t instance_offset = 0;
+        auto* vertices = reinterpret_cast<PackedVertex*>(m_vertex_stream.alloc(n_vertices * sizeof(PackedVertex), sizeof(PackedVertex), vertex_offset));
+        auto* indices = reinterpret_cast<uint16_t*>(m_index_stream.alloc(n_indices * sizeof(uint16_t), sizeof(uint16_t), index_offset));
+        auto* instances = reinterpret_cast<Instance*>(m_instance_stream.alloc(n_instances * sizeof(Instance), sizeof(Instance), instance_offset));
+        auto first_vertex = static_cast<GLint>(vertex_offset / sizeof(PackedVertex));
+        auto first_index = static_cast<GLsizei>(index_offset / sizeof(uint16_t));
+        auto first_instance = static_cast<GLint>(instance_offset / sizeof(Instance));
+
+        // Items that end up next to each other with the same state share a batch
+        for (const auto& entry : m_sort_entries) {
+            const DrawItem& item = items[entry.item];
+            const bool translucent = (entry.key >> 63) != 0;
+
+            // Cached items are already on the GPU
+            if (item.cached) {
+                DrawBatch& batch = get_batch(frame, item, translucent, static_cast<GLint>(item.first_vertex), static_cast<GLsizei>(item.first_index));
+                batch.n_vertices += static_cast<GLsizei>(item.n_vertices);
+                batch.n_indices += static_cast<GLsizei>(item.n_indices);
+                continue;
+            }
+
+            if (item.type == BatchType::instances) {
+                DrawBatch& batch = get_batch(frame, item, translucent, first_instance, 0);
+                memcpy(instances, &frame.instances[item.first_vertex], item.n_vertices * sizeof(Instance));
+                instances += item.n_vertices;
+                first_instance += static_cast<GLint>(item.n_vertices);
+                batch.n_vertices += static_cast<GLsizei>(item.n_vertices);
+                continue;
+            }
+
+            DrawBatch& batch = get_batch(frame, item, translucent, first_vertex, first_index);
+            memcpy(vertices, &frame.vertices[item.first_vertex], item.n_vertices * sizeof(PackedVertex));
+
+            // Indices are relative to the start of the batch
+            const auto base_vertex = static_cast<uint16_t>(batch.n_vertices);
+            for (uint32_t i = 0; i < item.n_indices; ++i) {
+                indices[i] = static_cast<uint16_t>(frame.indices[item.first_index + i] + base_vertex);
+            }
+            vertices += item.n_vertices;
+            indices += item.n_indices;
+            first_vertex += static_cast<GLint>(item.n_vertices);
+            first_index += static_cast<GLsizei>(item.n_indices);
+            batch.n_vertices += static_cast<GLsizei>(item.n_vertices);
+            batch.n_indices += static_cast<GLsizei>(item.n_indices);
+        }
+    }
+
+    DrawBatch& GLBackend::get_batch(const FrameCommands& frame, const DrawItem& item, const bool translucent, const GLint first_vertex, const GLsizei first_index) {
+        // If the item directly follows the previous batch with the same state and the textures are compatible, extend that batch.
+        // Untextured geometry doesn't care which texture is bound, so it can join any batch.
+        const glm::ivec4& clip = frame.clip_rects[item.clip];
+        if (!m_batches.empty()) {
+            DrawBatch& last = m_batches.back();
+            const bool contiguous = last.first_vertex + last.n_vertices == first_vertex && (item.type != BatchType::indexed || last.first_index + last.n_indices == first_index);
+            // Cached indices are relative to their own item, so cached indexed items can't share a batch
+            const bool fits = item.type != BatchType::indexed || (!item.cached && static_cast<size_t>(last.n_vertices) + item.n_vertices <= QUAD_INDEX_BUFFER_QUADS * 4);
+            const bool same_texture = item.texture == 0 || last.texture == 0 || last.texture == item.texture;
+            if (last.type == item.type && last.cached == item.cached && contiguous && fits && same_texture && last.clip == clip && last.translucent == translucent && last.offset == item.offset) {
+                if (last.texture == 0) last.texture = item.texture;
+                return last;
+            }
+        }
+
+        // Otherwise start a new batch
+        return m_batches.emplace_back(DrawBatch{ item.texture, item.type, first_vertex, 0, first_index, 0, clip, translucent, item.cached, item.offset });
+    }
+
+    GLuint GLBackend::create_texture(const glm::ivec2 size, const uint8_t* pixels, const bool repeat) {
+        GLuint texture = 0;
+        glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+        glTextureStorage2D(texture, 1, GL_RGBA8, size.x, size.y);
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_S, repeat ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_T, repeat ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+        if (pixels) {
+            update_texture(texture, { 0, 0 }, size, pixels);
+        }
+        else {
+            constexpr uint8_t clear_color[4] = { 0, 0, 0, 0 };
+            glClearTexImage(texture, 0, GL_RGBA, GL_UNSIGNED_BYTE, clear_color);
+        }
+        return texture;
+    }
+
+    void GLBackend::update_texture(const GLuint texture, const glm::ivec2 offset, const glm::ivec2 size, const uint8_t* pixels) {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTextureSubImage2D(texture, 0, offset.x, offset.y, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    }
+}
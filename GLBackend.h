@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "GL/glcorearb.h"
+#include "glfw/glfw3.h"
+#include "glm/vec2.hpp"
+#include "glm/vec4.hpp"
+#include "GeometryCache.h"
+#include "RenderBackend.h"
+#include "RendererStructs.h"
+#include "StreamBuffer.h"
+
+namespace Flan {
+    // GPU side of a CacheBuffer. The renderer hands out the ranges, this only applies the uploads. When it's too small it grows by copying into a bigger buffer on the GPU
+    class GLCacheBuffer {
+    public:
+        void init(size_t element_size, uint32_t capacity);
+        void destroy();
+        void apply(const CacheUploads& uploads);
+        [[nodiscard]] GLuint id() const { return m_id; }
+
+    private:
+        void grow(uint32_t new_capacity);
+
+        GLuint m_id = 0;
+        size_t m_element_size = 0;
+        uint32_t m_capacity = 0;
+    };
+
+    // Draws command lists with OpenGL 4.6 into a GLFW window
+    class GLBackend : public RenderBackend {
+    public:
+        // The context has to be current. The shaders are owned by the renderer, which loads them from its resources
+        void init(GLFWwindow* window, GLuint shader, GLuint instance_shader);
+
+        void bind_thread() override { glfwMakeContextCurrent(m_window); }
+        void unbind_thread() override { glfwMakeContextCurrent(nullptr); }
+        void submit_frame(FrameCommands& frame) override;
+        [[nodiscard]] GLuint create_texture(glm::ivec2 size, const uint8_t* pixels, bool repeat) override;
+        void update_texture(GLuint texture, glm::ivec2 offset, glm::ivec2 size, const uint8_t* pixels) override;
+        void create_render_target(glm::ivec2 size, GLuint& fbo, GLuint& color, GLuint& depth) override;
+        void destroy_render_target(GLuint& fbo, GLuint& color, GLuint& depth) override;
+
+    private:
+        void sort_draw_items(FrameCommands& frame, std::span<const DrawItem> items);
+        void upload_draw_items(const FrameCommands& frame, std::span<const DrawItem> items);
+        DrawBatch& get_batch(const FrameCommands& frame, const DrawItem& item, bool translucent, GLint first_vertex, GLsizei first_index);
+        void resize_frame_buffer(glm::ivec2 resolution);
+        void draw_batches(FrameCommands& frame, const glm::ivec4& limit, const glm::ivec4& target);
+
+        GLFWwindow* m_window = nullptr;
+        GLuint m_shader{};
+        GLuint m_vao{};
+        GLuint m_instance_shader{};
+        GLuint m_instance_vao{};
+
+        #define QUAD_INDEX_BUFFER_QUADS 16384 // 65536 vertices, the most 16-bit indices can address
+        StreamBuffer m_vertex_stream;
+        StreamBuffer m_index_stream;
+        StreamBuffer m_instance_stream;
+        GLuint m_quad_index_buffer{};
+
+        // Submitting a command list copies it into the streams in sorted order. That's one copy of the frame's geometry, the price of sorting after recording
+        std::vector<SortEntry> m_sort_entries;
+        std::vector<SortEntry> m_sort_scratch;
+        std::vector<DrawBatch> m_batches;
+
+        // Retained geometry, kept across frames
+        GLCacheBuffer m_cached_vertices;
+        GLCacheBuffer m_cached_indices;
+        GLCacheBuffer m_cached_instances;
+
+        // Frames are drawn into an offscreen buffer that keeps its contents, so only the damaged part has to be redrawn
+        GLuint m_frame_fbo{};
+        GLuint m_frame_color{};
+        GLuint m_frame_depth{};
+        glm::ivec2 m_frame_res{};
+    };
+}
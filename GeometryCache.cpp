@@ -0,0 +1,85 @@
+#include "GeometryCache.h"
+
+#include <algorithm>
+
+namespace Flan {
+    void RangeAllocator::init(const uint32_t capacity) {
+        m_capacity = capacity;
+        m_free.clear();
+        m_free.push_back({ 0, capacity });
+    }
+
+    bool RangeAllocator::alloc(const uint32_t size, CacheRange& range) {
+        for (size_t i = 0; i < m_free.size(); ++i) {
+            CacheRange& block = m_free[i];
+            if (block.size < size) continue;
+
+            // Take it from the start of the free block
+            range = { block.offset, size };
+            block.offset += size;
+            block.size -= size;
+            if (block.size == 0) m_free.erase(m_free.begin() + static_cast<ptrdiff_t>(i));
+            return true;
+        }
+        return false;
+    }
+
+    void RangeAllocator::free(const CacheRange range) {
+        if (range.size == 0) return;
+
+        // Insert it in order, then merge with the blocks on either side
+        auto it = std::lower_bound(m_free.begin(), m_free.end(), range.offset, [](const CacheRange& block, const uint32_t offset) { return block.offset < offset; });
+        it = m_free.insert(it, range);
+        if (it + 1 != m_free.end() && it->offset + it->size == (it + 1)->offset) {
+            it->size += (it + 1)->size;
+            m_free.erase(it + 1);
+        }
+        if (it != m_free.begin() && (it - 1)->offset + (it - 1)->size == it->offset) {
+            (it - 1)->size += it->size;
+            m_free.erase(it);
+        }
+    }
+
+    void RangeAllocator::grow(const uint32_t new_capacity) {
+        free({ m_capacity, new_capacity - m_capacity });
+        m_capacity = new_capacity;
+    }
+
+    void CacheBuffer::init(const size_t element_size, const uint32_t capacity) {
+        m_element_size = element_size;
+        m_capacity = capacity;
+        m_allocator.init(capacity);
+    }
+
+    size_t CacheBuffer::store(const void* data, const uint32_t n_elements, CacheRange& range) {
+        release(range);
+        if (n_elements == 0) return 0;
+
+        // Running out of space only grows the allocator here, the backend's buffer catches up when it applies the uploads
+        if (!m_allocator.alloc(n_elements, range)) {
+            const uint32_t new_capacity = std::max(m_capacity * 2, m_capacity + n_elements);
+            m_allocator.grow(new_capacity);
+            m_capacity = new_capacity;
+            m_allocator.alloc(n_elements, range);
+        }
+
+        const size_t size = n_elements * m_element_size;
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        m_pending.ranges.push_back(range);
+        m_pending.data.insert(m_pending.data.end(), bytes, bytes + size);
+        return size;
+    }
+
+    void CacheBuffer::release(CacheRange& range) {
+        m_allocator.free(range);
+        range = {};
+    }
+
+    void CacheBuffer::take_uploads(CacheUploads& uploads) {
+        uploads.ranges.clear();
+        uploads.data.clear();
+        uploads.ranges.swap(m_pending.ranges);
+        uploads.data.swap(m_pending.data);
+        uploads.capacity = m_capacity;
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "GL/glcorearb.h"
+#include "glm/vec2.hpp"
+#include "glm/vec4.hpp"
+#include "RendererStructs.h"
+
+namespace Flan {
+    // A range of elements inside a cache buffer
+    struct CacheRange {
+        uint32_t offset = 0;
+        uint32_t size = 0;
+    };
+
+    // First fit allocator over a range of elements. Freed ranges are merged with their neighbours
+    class RangeAllocator {
+    public:
+        void init(uint32_t capacity);
+        bool alloc(uint32_t size, CacheRange& range);
+        void free(CacheRange range);
+
+        // Add space at the end
+        void grow(uint32_t new_capacity);
+
+    private:
+        std::vector<CacheRange> m_free; // Sorted by offset
+        uint32_t m_capacity = 0;
+    };
+
+    // Uploads recorded by CacheBuffer::store(), waiting to be copied into the backend's buffer by the thread that submits frames
+    struct CacheUploads {
+        uint32_t capacity = 0;          // Elements the buffer has to hold by then
+        std::vector<CacheRange> ranges; // In the order they were stored, later ones overwrite earlier ones
+        std::vector<uint8_t> data;      // Contents of all the ranges, back to back
+    };
+
+    // Initial capacity of the cache buffers, in elements
+    #define CACHE_VERTICES (64 * 1024)
+    #define CACHE_INDICES (64 * 1024)
+    #define CACHE_INSTANCES (16 * 1024)
+
+    // Persistent buffer that is sub-allocated between cache entries. This is the renderer's side: ranges are handed out right away, and the contents
+    // are recorded as uploads that the backend applies to its copy of the buffer before drawing anything that uses them. Running out of space grows it
+    class CacheBuffer {
+    public:
+        void init(size_t element_size, uint32_t capacity);
+
+        // Copy elements into a new range, freeing the old one. Returns the number of bytes that will be uploaded
+        size_t store(const void* data, uint32_t n_elements, CacheRange& range);
+        void release(CacheRange& range);
+
+        // Move the uploads recorded since the last call into uploads
+        void take_uploads(CacheUploads& uploads);
+
+    private:
+        size_t m_element_size = 0;
+        uint32_t m_capacity = 0;
+        RangeAllocator m_allocator;
+        CacheUploads m_pending;
+    };
+
+    // The geometry of one draw_cached() call. Positions are relative to anchor points and nothing was culled, so it stays valid when the window is resized
+    struct CacheEntry {
+        std::vector<DrawItem> items;       // Offsets point into the cache buffers, and the sort key doesn't have the clip yet
+        std::vector<glm::ivec4> clip_rects; // Scissor box of every item, relative to the item's clip anchor
+        CacheRange vertices;
+        CacheRange indices;
+        CacheRange instances;
+        bool valid = false;
+    };
+
+    // An offscreen texture that a group of draw items was rendered into, drawn as a single quad. Unlike a cache entry, it's only valid for the resolution and clip rectangle it was rendered with
+    struct LayerEntry {
+        GLuint fbo = 0;
+        GLuint color = 0;
+        GLuint depth = 0;
+        glm::ivec2 size{};
+        glm::ivec4 rect{};           // Window pixels covered by the texture: x0, y0, x1, y1 (exclusive)
+        float composite_depth = 0.0f; // Depth of the quad it's drawn with
+        glm::ivec2 resolution{};
+        glm::vec4 parent_clip{};
+        bool valid = false;
+    };
+}
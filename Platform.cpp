@@ -0,0 +1,44 @@
+#include "Platform.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace Flan {
+    bool read_file(const std::string& path, std::vector<char>& data) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.good()) return false;
+        data.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0, std::ios::beg);
+        return static_cast<bool>(file.read(data.data(), static_cast<std::streamsize>(data.size())));
+    }
+
+#ifdef _WIN32
+    bool read_resource(const std::string& name, const ResourceType type, const ModuleHandle module, std::vector<char>& data) {
+        // Resource names are wide strings
+        std::wstring wname;
+        wname.resize(name.size() + 1);
+        size_t converted_chars = 0;
+        mbstowcs_s(&converted_chars, wname.data(), wname.size(), name.c_str(), name.size());
+        const wchar_t* type_name = type == ResourceType::png ? L"PNG" : L"ShaderSource";
+
+        // Find the resource and map it, it stays loaded as long as the module does
+        const HRSRC resource_handle = FindResource(module, wname.c_str(), type_name);
+        if (!resource_handle) return false;
+        const HGLOBAL resource_data_handle = LoadResource(module, resource_handle);
+        if (!resource_data_handle) return false;
+        const LPVOID resource_data = LockResource(resource_data_handle);
+        if (!resource_data) return false;
+        const DWORD resource_data_size = SizeofResource(module, resource_handle);
+        if (!resource_data_size) return false;
+
+        data.resize(resource_data_size);
+        memcpy(data.data(), resource_data, resource_data_size);
+        return true;
+    }
+#else
+    bool read_resource(const std::string& name, const ResourceType type, ModuleHandle, std::vector<char>& data) {
+        // Same layout as FlanGUI.rc: shaders in Shaders/, images next to the executable
+        return read_file(type == ResourceType::shader_source ? "Shaders/" + name : name, data);
+    }
+#endif
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN 1
+#endif
+#include <Windows.h>
+#endif
+
+namespace Flan {
+    // Where resources are looked up. On Windows they're compiled into a module by FlanGUI.rc, null is the executable.
+    // Everywhere else they're the files the resource script points at, relative to the working directory, and the handle is ignored
+#ifdef _WIN32
+    using ModuleHandle = HMODULE;
+#else
+    using ModuleHandle = void*;
+#endif
+
+    enum class ResourceType {
+        png,
+        shader_source,
+    };
+
+    // Whole file into data. False if it can't be opened
+    [[nodiscard]] bool read_file(const std::string& path, std::vector<char>& data);
+
+    // Copy of a resource into data, by the name it has in FlanGUI.rc. False if there's no such resource
+    [[nodiscard]] bool read_resource(const std::string& name, ResourceType type, ModuleHandle module, std::vector<char>& data);
+}
@@ -0,0 +1,160 @@
+#include "RenderBackend.h"
+
+#include <cstdio>
+
+namespace Flan {
+    void NullBackend::submit_frame(FrameCommands& frame) {
+        // Count what the GL backend would have drawn, without batching
+        const auto count = [&frame](const std::vector<DrawItem>& items) {
+            for (const DrawItem& item : items) {
+                if (item.type == BatchType::instances) frame.stats.n_instances += item.n_vertices;
+                else frame.stats.n_vertices += item.n_vertices;
+                frame.stats.n_indices += item.type == BatchType::quads ? item.n_vertices / 4 * 6 : item.n_indices;
+                frame.stats.n_cached_items += item.cached ? 1 : 0;
+            }
+            frame.stats.n_draw_items += static_cast<uint32_t>(items.size());
+        };
+        count(frame.layer_items);
+        count(frame.draw_items);
+        frame.stats.n_bytes_uploaded += frame.vertices.size() * sizeof(PackedVertex) + frame.indices.size() * sizeof(uint16_t) + frame.instances.size() * sizeof(Instance);
+        m_n_frames++;
+    }
+
+    GLuint NullBackend::create_texture(glm::ivec2, const uint8_t*, bool) {
+        return m_next_handle++;
+    }
+
+    void NullBackend::create_render_target(glm::ivec2, GLuint& fbo, GLuint& color, GLuint& depth) {
+        fbo = m_next_handle++;
+        color = m_next_handle++;
+        depth = m_next_handle++;
+    }
+
+    void NullBackend::destroy_render_target(GLuint& fbo, GLuint& color, GLuint& depth) {
+        fbo = color = depth = 0;
+    }
+
+    bool RecordingBackend::open(const std::string& path) {
+        m_file.open(path, std::ios::binary | std::ios::trunc);
+        if (!m_file.is_open()) {
+            printf("ERROR: Failed to open '%s' for recording\n", path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    void RecordingBackend::bind_thread() {
+        if (m_inner) m_inner->bind_thread();
+    }
+
+    void RecordingBackend::unbind_thread() {
+        if (m_inner) m_inner->unbind_thread();
+    }
+
+    void RecordingBackend::submit_frame(FrameCommands& frame) {
+        // The frame as the renderer generated it, before the backend adds its draw calls to the stats
+        write(frame.resolution);
+        write(frame.damage);
+        write_array(frame.vertices);
+        write_array(frame.indices);
+        write_array(frame.instances);
+        write_items(frame.draw_items);
+        write_array(frame.clip_rects);
+        write_items(frame.layer_items);
+        write(static_cast<uint32_t>(frame.layers.size()));
+        for (const LayerPass& pass : frame.layers) {
+            write(pass.fbo);
+            write(pass.rect);
+            write(pass.first_item);
+            write(pass.n_items);
+        }
+        write_uploads(frame.cached_vertices);
+        write_uploads(frame.cached_indices);
+        write_uploads(frame.cached_instances);
+        end_record(RenderCommand::submit_frame);
+
+        if (m_inner) m_inner->submit_frame(frame);
+        else NullBackend::submit_frame(frame);
+    }
+
+    GLuint RecordingBackend::create_texture(const glm::ivec2 size, const uint8_t* pixels, const bool repeat) {
+        const GLuint texture = m_inner ? m_inner->create_texture(size, pixels, repeat) : NullBackend::create_texture(size, pixels, repeat);
+        write(texture);
+        write(size);
+        write(static_cast<uint8_t>(repeat));
+        if (pixels) write(pixels, static_cast<size_t>(size.x) * size.y * 4);
+        end_record(RenderCommand::create_texture);
+        return texture;
+    }
+
+    void RecordingBackend::update_texture(const GLuint texture, const glm::ivec2 offset, const glm::ivec2 size, const uint8_t* pixels) {
+        write(texture);
+        write(offset);
+        write(size);
+        write(pixels, static_cast<size_t>(size.x) * size.y * 4);
+        end_record(RenderCommand::update_texture);
+        if (m_inner) m_inner->update_texture(texture, offset, size, pixels);
+    }
+
+    void RecordingBackend::create_render_target(const glm::ivec2 size, GLuint& fbo, GLuint& color, GLuint& depth) {
+        if (m_inner) m_inner->create_render_target(size, fbo, color, depth);
+        else NullBackend::create_render_target(size, fbo, color, depth);
+        write(size);
+        write(fbo);
+        write(color);
+        write(depth);
+        end_record(RenderCommand::create_render_target);
+    }
+
+    void RecordingBackend::destroy_render_target(GLuint& fbo, GLuint& color, GLuint& depth) {
+        write(fbo);
+        write(color);
+        write(depth);
+        end_record(RenderCommand::destroy_render_target);
+        if (m_inner) m_inner->destroy_render_target(fbo, color, depth);
+        else NullBackend::destroy_render_target(fbo, color, depth);
+    }
+
+    void RecordingBackend::write(const void* data, const size_t size) {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        m_record.insert(m_record.end(), bytes, bytes + size);
+    }
+
+    void RecordingBackend::write_items(const std::vector<DrawItem>& items) {
+        // The sort key, hash and bounds are derived from the rest, and the struct has padding that isn't initialized
+        write(static_cast<uint32_t>(items.size()));
+        for (const DrawItem& item : items) {
+            write(item.type);
+            write(static_cast<uint8_t>(item.cached));
+            write(item.texture);
+            write(item.clip);
+            write(item.first_vertex);
+            write(item.n_vertices);
+            write(item.first_index);
+            write(item.n_indices);
+            write(item.offset);
+            write(static_cast<uint8_t>(item.anchor));
+            write(static_cast<uint8_t>(item.clip_anchor));
+        }
+    }
+
+    void RecordingBackend::write_uploads(const CacheUploads& uploads) {
+        write(uploads.capacity);
+        write_array(uploads.ranges);
+        write_array(uploads.data);
+    }
+
+    void RecordingBackend::end_record(const RenderCommand command) {
+        const uint32_t header[2] = { static_cast<uint32_t>(command), static_cast<uint32_t>(m_record.size()) };
+        if (m_file.is_open()) {
+            m_file.write(reinterpret_cast<const char*>(header), sizeof(header));
+            m_file.write(reinterpret_cast<const char*>(m_record.data()), static_cast<std::streamsize>(m_record.size()));
+        }
+        else {
+            const auto* bytes = reinterpret_cast<const uint8_t*>(header);
+            m_data.insert(m_data.end(), bytes, bytes + sizeof(header));
+            m_data.insert(m_data.end(), m_record.begin(), m_record.end());
+        }
+        m_record.clear();
+    }
+}
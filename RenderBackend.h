@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GL/glcorearb.h"
+#include "glm/vec2.hpp"
+#include "FrameCommands.h"
+
+namespace Flan {
+    // Everything the renderer needs from a graphics API. The renderer only generates command lists, so the same geometry can be drawn with GL, counted, or recorded.
+    // All functions are called on one thread at a time, which is the render thread if there is one. Handles are opaque to the renderer, 0 means none
+    class RenderBackend {
+    public:
+        virtual ~RenderBackend() = default;
+
+        // Called when a thread starts or stops issuing commands, for APIs with a per-thread context
+        virtual void bind_thread() {}
+        virtual void unbind_thread() {}
+
+        // Draw and present a frame. Adds the draw calls to frame.stats
+        virtual void submit_frame(FrameCommands& frame) = 0;
+
+        // RGBA8 textures. Null pixels create a transparent texture, repeat picks wrapping over clamping to the edge
+        [[nodiscard]] virtual GLuint create_texture(glm::ivec2 size, const uint8_t* pixels, bool repeat) = 0;
+        virtual void update_texture(GLuint texture, glm::ivec2 offset, glm::ivec2 size, const uint8_t* pixels) = 0;
+
+        // Offscreen color and depth buffers for layers. Destroying zeroes the handles
+        virtual void create_render_target(glm::ivec2 size, GLuint& fbo, GLuint& color, GLuint& depth) = 0;
+        virtual void destroy_render_target(GLuint& fbo, GLuint& color, GLuint& depth) = 0;
+    };
+
+    // Draws nothing. Handles are made up, and frames only add what would have been drawn to the stats, for benchmarking geometry generation without a GPU
+    class NullBackend : public RenderBackend {
+    public:
+        void submit_frame(FrameCommands& frame) override;
+        [[nodiscard]] GLuint create_texture(glm::ivec2 size, const uint8_t* pixels, bool repeat) override;
+        void update_texture(GLuint, glm::ivec2, glm::ivec2, const uint8_t*) override {}
+        void create_render_target(glm::ivec2 size, GLuint& fbo, GLuint& color, GLuint& depth) override;
+        void destroy_render_target(GLuint& fbo, GLuint& color, GLuint& depth) override;
+
+        [[nodiscard]] uint64_t n_frames() const { return m_n_frames; }
+
+    private:
+        GLuint m_next_handle = 1;
+        uint64_t m_n_frames = 0;
+    };
+
+    enum class RenderCommand : uint32_t {
+        create_texture,
+        update_texture,
+        create_render_target,
+        destroy_render_target,
+        submit_frame,
+    };
+
+    // Writes every command to memory or a file, then passes it on to another backend if it has one. Each record is the command, the size of the payload in bytes,
+    // and the payload. Draw items are written field by field, so the same frames always give the same bytes and recordings can be compared between runs
+    class RecordingBackend : public NullBackend {
+    public:
+        explicit RecordingBackend(std::unique_ptr<RenderBackend> inner = nullptr) : m_inner(std::move(inner)) {}
+
+        // Stream the records into a file instead of keeping them in memory
+        bool open(const std::string& path);
+
+        void bind_thread() override;
+        void unbind_thread() override;
+        void submit_frame(FrameCommands& frame) override;
+        [[nodiscard]] GLuint create_texture(glm::ivec2 size, const uint8_t* pixels, bool repeat) override;
+        void update_texture(GLuint texture, glm::ivec2 offset, glm::ivec2 size, const uint8_t* pixels) override;
+        void create_render_target(glm::ivec2 size, GLuint& fbo, GLuint& color, GLuint& depth) override;
+        void destroy_render_target(GLuint& fbo, GLuint& color, GLuint& depth) override;
+
+        [[nodiscard]] const std::vector<uint8_t>& data() const { return m_data; } // Records so far, when not writing to a file
+        void clear() { m_data.clear(); }
+
+    private:
+        void write(const void* data, size_t size);
+        template <typename T> void write(const T& value) { write(&value, sizeof(T)); }
+        template <typename T> void write_array(const std::vector<T>& values) {
+            write(static_cast<uint32_t>(values.size()));
+            write(values.data(), values.size() * sizeof(T));
+        }
+        void write_items(const std::vector<DrawItem>& items);
+        void write_uploads(const CacheUploads& uploads);
+        void end_record(RenderCommand command);
+
+        std::unique_ptr<RenderBackend> m_inner;
+        std::vector<uint8_t> m_data;
+        std::vector<uint8_t> m_record; // Payload of the record that's being written
+        std::ofstream m_file;
+    };
+}
@@ -1,6 +1,8 @@
 // ReSharper disable CppClangTidyPerformanceNoIntToPtr
 #include "Renderer.h"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <string_view>
 #include <utility>
@@ -9,7 +11,10 @@
 #include "glm/geometric.hpp"
 #include "glm/gtx/exterior_product.hpp"
 #define STB_IMAGE_IMPLEMENTATION
-#include "ComponentsGUI.h"
+#include "AllocationTracker.h"
+#include "GLBackend.h"
+#include "Platform.h"
+#include "SimdPacking.h"
 #include "stb/stb_image.h"
 
 
@@ -131,55 +136,6 @@ message:	%s\n",
 
 
 namespace Flan {
-    bool read_file(const std::string& path, int& size, char*& data) {
-        // Open file
-        std::ifstream file;
-        file.open(path.c_str(), std::ios::binary | std::ios::in);
-        if (file.good() == false) return false;
-
-        // Get size
-        const std::streampos startpos = file.tellg();
-        file.seekg(0, std::ios::end);
-        size = static_cast<int>(file.tellg() - startpos);
-        file.seekg(0, std::ios::beg);
-
-        // Get data
-        data = static_cast<char*>(malloc(size));
-        if (!data) return false;
-        file.read(data, size);
-
-        return true;
-    }
-
-    bool read_resource(const std::string& name, int& size, char*& data, const std::wstring& type, HMODULE dll) {
-        // Convert to wstring
-        std::wstring wname;
-        wname.resize(name.size() + 1);
-        size_t converted_chars = 0;
-        mbstowcs_s(&converted_chars, wname.data(), wname.size(), name.c_str(), name.size());
-
-        // Find the resource
-        const HRSRC resource_handle = FindResource(dll, wname.c_str(), type.c_str());
-        if (!resource_handle) return false;
-
-        // Load it into memory
-        const HGLOBAL resource_data_handle = LoadResource(dll, resource_handle);
-        if (!resource_data_handle) return false;
-
-        // Get the pointer to the data
-        const LPVOID resource_data = LockResource(resource_data_handle);
-        if (!resource_data) return false;
-
-        // Get the size of the data
-        const DWORD resource_data_size = SizeofResource(dll, resource_handle);
-        if (!resource_data_size) return false;
-
-        // Return the data into the parameters
-        size = static_cast<int>(resource_data_size);
-        data = static_cast<char*>(resource_data);
-
-        return true;
-    }
     const std::string vert_shader =
         "#version 330 core\n"
         "precision mediump float;\n"
@@ -222,6 +178,22 @@ namespace Flan {
         {-1,  0}, // left
     };
 
+    // The draw list the calling thread records into, between begin_draw_list() and end_draw_list(). Threads without one draw into the main list
+    thread_local DrawList* t_draw_list = nullptr;
+
+    // Where every anchor point is in the window, as a fraction of the resolution. Same table as in sprite.vert and instance.vert
+    const glm::vec2 pixel_anchor_offsets[] = {
+        {0.5f, 0.5f}, // center
+        {0.0f, 0.0f}, // top left
+        {0.5f, 0.0f}, // top
+        {1.0f, 0.0f}, // top right
+        {1.0f, 0.5f}, // right
+        {1.0f, 1.0f}, // bottom right
+        {0.5f, 1.0f}, // bottom
+        {0.0f, 1.0f}, // bottom left
+        {0.0f, 0.5f}, // left
+    };
+
     void Renderer::init(bool invisible) {
         // Init + window settings
         glfwInit();
@@ -250,63 +222,187 @@ namespace Flan {
         glfwMakeContextCurrent(nullptr);
     }
 
-    void Renderer::init(const int w, const int h, const bool invisible, HMODULE dll_handle)
+    void Renderer::init(const int w, const int h, const bool invisible, const ModuleHandle module)
     {
         m_res.x = w;
         m_res.y = h;
-        m_dll = dll_handle;
+        m_module = module;
         init(invisible);
     }
 
     void Renderer::init(GLFWwindow* window) {
         // Init basic rendering
         m_window = window;
-        glClearColor(0.1f, 0.1f, 0.2f, 1.0f);
         glfwSwapInterval(1);
+        if (const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor()); mode && mode->refreshRate > 0) {
+            m_frame_interval = 1.0 / mode->refreshRate;
+        }
         //_shader = shader_from_file("Shaders\\sprite");
-        m_shader = shader_from_resource("sprite");
-        load_font("font.png");
         //shader = shader_from_string(vert_shader, frag_shader);
-        glUseProgram(m_shader);
-
-        // Create vertex buffer
-        glGenVertexArrays(1, &m_vao);
-        glGenBuffers(1, &m_vbo);
-        glBindVertexArray(m_vao);
-        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-
-        // Setup vertex array
-        glVertexAttribPointer(0, sizeof(Vertex::pos      ) / sizeof(float), GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, pos      .x)));
-        glVertexAttribPointer(1, sizeof(Vertex::tc       ) / sizeof(float), GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, tc       .x)));
-        glVertexAttribPointer(2, sizeof(Vertex::color    ) / sizeof(float), GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, color    .x)));
-        glVertexAttribPointer(3, sizeof(Vertex::clip_rect) / sizeof(float), GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, clip_rect.x)));
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-        glEnableVertexAttribArray(2);
-        glEnableVertexAttribArray(3);
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        auto backend = std::make_unique<GLBackend>();
+        backend->init(window, shader_from_resource("sprite"), shader_from_resource("instance"));
+        m_backend = std::move(backend);
+        init_resources();
+    }
+
+    void Renderer::init_headless(std::unique_ptr<RenderBackend> backend, const glm::ivec2 resolution) {
+        // Nothing to poll or present, so every frame is generated and submitted right away
+        m_res = resolution;
+        m_backend = std::move(backend);
+        init_resources();
+    }
+
+    void Renderer::init_resources() {
+        m_atlas.init(ATLAS_PAGE_SIZE, m_backend.get());
+        load_font("font.png");
+        init_luts(); // Up front, so text can be drawn on any thread
+
+        // Retained geometry, the backend applies the uploads to its own buffers
+        m_cached_vertices.init(sizeof(PackedVertex), CACHE_VERTICES);
+        m_cached_indices.init(sizeof(uint16_t), CACHE_INDICES);
+        m_cached_instances.init(sizeof(Instance), CACHE_INSTANCES);
     }
 
     void Renderer::begin_frame() {
-        // Setup render context
-        glfwMakeContextCurrent(m_window);
-        glfwPollEvents();
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glFrontFace(GL_CCW);
-        glEnable(GL_DEPTH_TEST);
-        glDisable(GL_CULL_FACE);
+        // The previous frame ends here, it includes everything the systems did after end_frame()
+        AllocationTracker::end_frame();
+        AllocationScope allocation_scope(AllocSubsystem::renderer);
+
+        // Without a render thread, the backend is used on this thread
+        if (!m_render_thread.joinable()) m_backend->bind_thread();
+        wait_for_frame();
+
+        // Handle window size changes. The frame buffer is resized when the frame is submitted, and starts out empty
+        if (m_window) glfwGetWindowSize(m_window, &m_res.x, &m_res.y);
+        if (m_res != m_damage_res) {
+            m_damage.invalidate();
+            m_damage_res = m_res;
+        }
+
+        // Start with empty arrays. The bottom of the clip stack is the whole window
+        m_draw_list.reset(m_res);
+        m_layer_items.clear();
+        m_layer_passes.clear();
+        m_frame_stats = {};
+        set_draw_clip({ 0.0f, 0.0f }, glm::vec2(m_res));
+    }
+
+    void Renderer::begin_draw_list(const uint32_t order) {
+        if (t_draw_list) {
+            printf("ERROR: begin_draw_list() called twice without end_draw_list()\n");
+            return;
+        }
+
+        // Lists are handed out in the order threads ask for them, and reused next frame
+        DrawList* list;
+        {
+            std::lock_guard lock(m_draw_list_mutex);
+            if (m_n_worker_lists == m_worker_lists.size()) m_worker_lists.push_back(std::make_unique<DrawList>());
+            list = m_worker_lists[m_n_worker_lists++].get();
+        }
+        list->reset(m_res);
+        list->order = order;
+        t_draw_list = list;
+        set_draw_clip({ 0.0f, 0.0f }, glm::vec2(m_res));
+    }
+
+    void Renderer::end_draw_list() {
+        if (!t_draw_list) {
+            printf("ERROR: end_draw_list() called without begin_draw_list()\n");
+            return;
+        }
+        if (t_draw_list->recording_cache) printf("ERROR: end_draw_list() called while recording a cache entry\n");
+        t_draw_list = nullptr;
+    }
+
+    DrawList& Renderer::draw_list() {
+        return t_draw_list ? *t_draw_list : m_draw_list;
+    }
+
+    const DrawList& Renderer::draw_list() const {
+        return t_draw_list ? *t_draw_list : m_draw_list;
+    }
+
+    void Renderer::merge_draw_lists() {
+        // Sorting by order instead of by when the threads asked for a list keeps the frame deterministic
+        const auto lists = std::span(m_worker_lists).first(m_n_worker_lists);
+        std::sort(lists.begin(), lists.end(), [](const auto& a, const auto& b) { return a->order < b->order; });
+
+        // Append everything to the main thread's list. Cached items point into the cache buffers, so only their clip index moves
+        DrawList& main = m_draw_list;
+        for (const auto& list : lists) {
+            const auto vertex_base = static_cast<uint32_t>(main.vertices.size());
+            const auto index_base = static_cast<uint32_t>(main.indices.size());
+            const auto instance_base = static_cast<uint32_t>(main.instances.size());
+            const auto clip_base = static_cast<uint32_t>(main.clip_rects.size());
+            main.vertices.insert(main.vertices.end(), list->vertices.begin(), list->vertices.end());
+            main.indices.insert(main.indices.end(), list->indices.begin(), list->indices.end());
+            main.instances.insert(main.instances.end(), list->instances.begin(), list->instances.end());
+            main.clip_rects.insert(main.clip_rects.end(), list->clip_rects.begin(), list->clip_rects.end());
+            for (DrawItem item : list->draw_items) {
+                item.clip += clip_base;
+                if (!item.cached && item.type == BatchType::instances) {
+                    item.first_vertex += instance_base;
+                }
+                else if (!item.cached) {
+                    item.first_vertex += vertex_base;
+                    item.first_index += index_base;
+                }
+                main.draw_items.push_back(item);
+            }
+        }
+        m_n_worker_lists = 0;
+    }
 
-        // Handle window size changes
-        glfwGetWindowSize(m_window, &m_res.x, &m_res.y);
-        glViewport(0, 0, m_res.x, m_res.y);
+    void Renderer::load_pending_textures() {
+        std::vector<std::string> pending;
+        {
+            std::lock_guard lock(m_texture_mutex);
+            if (m_pending_textures.empty()) return;
+            pending.swap(m_pending_textures);
+        }
+        for (const auto& texture : pending) get_texture(texture);
 
-        // Clear queues
-        m_flat_queue.clear();
-        m_textured_queue.clear();
+        // Cache entries that were stored with a placeholder have to be regenerated, and the frame has to be drawn again with the real textures
+        {
+            std::lock_guard lock(m_cache_mutex);
+            for (const uint32_t handle : m_placeholder_entries) {
+                if (handle < m_cache_entries.size()) m_cache_entries[handle].valid = false;
+            }
+            m_placeholder_entries.clear();
+        }
+        request_frame();
+    }
+
+    void Renderer::wait_for_frame() {
+        if (!m_window) {
+            m_frame_requested = false;
+            return;
+        }
+        if (m_frame_mode == FrameMode::continuous || m_frame_requested || m_frames_after_wake > 0) {
+            glfwPollEvents();
+        }
+        else {
+            // Sleep until there's input, another thread calls wake(), or the next deadline
+            if (m_frame_deadline == INFINITY) {
+                glfwWaitEvents();
+            }
+            else if (const double timeout = m_frame_deadline - glfwGetTime(); timeout > 0.0) {
+                glfwWaitEventsTimeout(timeout);
+            }
+            else {
+                glfwPollEvents();
+            }
+            m_frames_after_wake = FRAMES_AFTER_WAKE;
+        }
+
+        if (m_frame_deadline <= glfwGetTime()) m_frame_deadline = INFINITY;
+        if (m_frames_after_wake > 0) m_frames_after_wake--;
+        m_frame_requested = false;
+    }
 
-        // Clear screen
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    void Renderer::request_frame_at(const double time) {
+        m_frame_deadline = std::min(m_frame_deadline, time);
     }
 
     void Renderer::gl_error() {
@@ -316,135 +412,836 @@ namespace Flan {
         }
     }
 
-    void Renderer::end_frame() const {
-        // Set resolution uniform
-        const auto location = glGetUniformLocation(m_shader, "resolution");
-        glUniform2iv(location, 1, &m_res.x);
+    void Renderer::end_frame() {
+        AllocationScope allocation_scope(AllocSubsystem::renderer);
+        merge_draw_lists();
+        load_pending_textures();
+
+        // Work out what changed since the last frame
+        const glm::ivec4 damage = track_damage();
+        m_frame_stats.damage = damage;
+
+        // If nothing did, the last frame is still on screen. Instead of presenting, wait as long as a vsync would have, waking up early on input.
+        // In on-demand mode begin_frame() does the waiting. Cache entries stored this frame are uploaded with the next frame that is drawn
+        if (rect_empty(damage) && m_layer_passes.empty()) {
+            m_frame_stats.frame_skipped = true;
+            if (m_frame_mode == FrameMode::continuous && m_window) glfwWaitEventsTimeout(m_frame_interval);
+            m_stats = m_frame_stats;
+            return;
+        }
+
+        // Move the frame into a command list. The render thread might still be submitting what was in it two frames ago
+        FrameCommands& frame = m_frame_commands[m_recording];
+        wait_for_render_thread(m_frame_tickets[m_recording]);
+        frame.vertices.swap(m_draw_list.vertices);
+        frame.indices.swap(m_draw_list.indices);
+        frame.instances.swap(m_draw_list.instances);
+        frame.draw_items.swap(m_draw_list.draw_items);
+        frame.clip_rects.swap(m_draw_list.clip_rects);
+        frame.layer_items.swap(m_layer_items);
+        frame.layers.swap(m_layer_passes);
+        m_cached_vertices.take_uploads(frame.cached_vertices);
+        m_cached_indices.take_uploads(frame.cached_indices);
+        m_cached_instances.take_uploads(frame.cached_instances);
+        frame.resolution = m_res;
+        frame.damage = damage;
+        frame.stats = m_frame_stats;
+        frame.stats.n_bytes_uploaded = m_cache_bytes_uploaded;
+        m_cache_bytes_uploaded = 0;
+
+        if (!m_render_thread.joinable()) {
+            m_backend->submit_frame(frame);
+            m_stats = frame.stats;
+            return;
+        }
+
+        // The render thread draws and presents it while the next frame is generated
+        m_frame_tickets[m_recording] = post_to_render_thread([this, &frame] {
+            m_backend->submit_frame(frame);
+            std::lock_guard lock(m_render_mutex);
+            m_submitted_stats = frame.stats;
+        });
+        m_recording = 1 - m_recording;
+        std::lock_guard lock(m_render_mutex);
+        m_stats = m_submitted_stats;
+    }
+
+    void Renderer::set_render_thread(const bool enabled) {
+        if (enabled == m_render_thread.joinable()) return;
+        if (enabled) {
+            // A context can only be current on one thread at a time
+            m_backend->unbind_thread();
+            m_render_thread_quit = false;
+            m_render_thread = std::thread(&Renderer::render_thread_main, this);
+            return;
+        }
+
+        // It finishes what's been posted before it stops, and begin_frame() takes the context back
+        {
+            std::lock_guard lock(m_render_mutex);
+            m_render_thread_quit = true;
+        }
+        m_render_cv.notify_all();
+        m_render_thread.join();
+    }
+
+    Renderer::~Renderer() {
+        set_render_thread(false);
+    }
+
+    void Renderer::run_on_render_thread(const std::function<void()>& task) {
+        if (t_draw_list) {
+            printf("ERROR: run_on_render_thread() called on a draw list thread\n");
+            return;
+        }
+        if (!m_render_thread.joinable()) {
+            task();
+            return;
+        }
+        wait_for_render_thread(post_to_render_thread(task));
+    }
+
+    uint64_t Renderer::post_to_render_thread(std::function<void()> task) {
+        uint64_t ticket;
+        {
+            std::lock_guard lock(m_render_mutex);
+            m_render_tasks.push_back(std::move(task));
+            ticket = ++m_tasks_posted;
+        }
+        m_render_cv.notify_all();
+        return ticket;
+    }
+
+    void Renderer::wait_for_render_thread(const uint64_t ticket) {
+        std::unique_lock lock(m_render_mutex);
+        m_render_cv.wait(lock, [this, ticket] { return m_tasks_done >= ticket; });
+    }
+
+    void Renderer::render_thread_main() {
+        AllocationScope allocation_scope(AllocSubsystem::renderer);
+        m_backend->bind_thread();
+
+        std::unique_lock lock(m_render_mutex);
+        while (true) {
+            // Only stop once everything that was posted has run
+            m_render_cv.wait(lock, [this] { return !m_render_tasks.empty() || m_render_thread_quit; });
+            if (m_render_tasks.empty()) break;
+
+            // Take the whole queue, so the main thread can keep posting while it runs. Both vectors keep their memory
+            m_running_tasks.swap(m_render_tasks);
+            lock.unlock();
+            for (auto& task : m_running_tasks) {
+                task();
+                lock.lock();
+                m_tasks_done++;
+                lock.unlock();
+                m_render_cv.notify_all();
+            }
+            m_running_tasks.clear();
+            lock.lock();
+        }
+        lock.unlock();
+        m_backend->unbind_thread();
+    }
+
+    void Renderer::push_item(const BatchType type, const GLuint texture, const size_t first_vertex, const size_t n_verts, const size_t first_index, const size_t n_indices) {
+        DrawList& list = draw_list();
+        if (n_verts == 0) return;
+        push_clip_index(list.draw_clip);
+        list.draw_items.push_back(DrawItem{
+            type, false, texture, static_cast<uint32_t>(list.clip_rects.size() - 1),
+            static_cast<uint32_t>(first_vertex), static_cast<uint32_t>(n_verts),
+            static_cast<uint32_t>(first_index), static_cast<uint32_t>(n_indices), 0, 0, {}, {}, AnchorPoint::top_left, list.draw_clip_anchor,
+        });
+    }
+
+    void Renderer::push_clip_index(const glm::ivec4& clip) {
+        DrawList& list = draw_list();
+        // Consecutive draw calls usually share the same clip rectangle
+        if (list.clip_rects.empty() || list.clip_rects.back() != clip) {
+            list.clip_rects.push_back(clip);
+        }
+    }
+
+    PackedVertex* Renderer::push_quads(const size_t n_quads, const GLuint texture) {
+        DrawList& list = draw_list();
+        AllocationScope allocation_scope(AllocSubsystem::renderer);
+        // The indices are already in the quad index buffer
+        const size_t first_vertex = list.vertices.size();
+        list.vertices.resize(first_vertex + n_quads * 4);
+        push_item(BatchType::quads, texture, first_vertex, n_quads * 4, 0, 0);
+        return &list.vertices[first_vertex];
+    }
+
+    PackedVertex* Renderer::push_indexed(const size_t n_verts, const size_t n_indices, const GLuint texture, uint16_t*& indices) {
+        DrawList& list = draw_list();
+        AllocationScope allocation_scope(AllocSubsystem::renderer);
+        // Indices are relative to the first vertex of the item, they're moved to the start of the batch when uploading
+        const size_t first_vertex = list.vertices.size();
+        const size_t first_index = list.indices.size();
+        list.vertices.resize(first_vertex + n_verts);
+        list.indices.resize(first_index + n_indices);
+        push_item(BatchType::indexed, texture, first_vertex, n_verts, first_index, n_indices);
+        indices = &list.indices[first_index];
+        return &list.vertices[first_vertex];
+    }
+
+    Instance* Renderer::push_instances(const size_t n_instances, const GLuint texture) {
+        DrawList& list = draw_list();
+        AllocationScope allocation_scope(AllocSubsystem::renderer);
+        const size_t first_instance = list.instances.size();
+        list.instances.resize(first_instance + n_instances);
+        push_item(BatchType::instances, texture, first_instance, n_instances, 0, 0);
+        return &list.instances[first_instance];
+    }
+
+    void Renderer::trim_last_item(const size_t n_used) {
+        DrawList& list = draw_list();
+        // The bulk draw functions reserve room for every primitive, and give back what was culled
+        DrawItem& item = list.draw_items.back();
+        if (item.type == BatchType::instances) {
+            list.instances.resize(item.first_vertex + n_used);
+            item.n_vertices = static_cast<uint32_t>(n_used);
+        }
+        else {
+            list.vertices.resize(item.first_vertex + n_used * 4);
+            item.n_vertices = static_cast<uint32_t>(n_used * 4);
+        }
+        if (n_used == 0) list.draw_items.pop_back();
+    }
+
+    PackedVertex* Renderer::push_polygon(const size_t n_verts, const GLuint texture) {
+        // Quads can use the shared quad index buffer
+        if (n_verts == 4) return push_quads(1, texture);
+
+        // Anything else becomes an indexed triangle fan
+        uint16_t* indices = nullptr;
+        PackedVertex* verts = push_indexed(n_verts, (n_verts - 2) * 3, texture, indices);
+        for (size_t i = 0; i < n_verts - 2; i++) {
+            *indices++ = 0;
+            *indices++ = static_cast<uint16_t>(i + 2);
+            *indices++ = static_cast<uint16_t>(i + 1);
+        }
+        return verts;
+    }
+
+    void Renderer::item_footprint(const DrawList& list, DrawItem& item) const {
+        // Hash the geometry as it was generated, so the same contents get the same hash wherever they end up in the buffers.
+        // A draw call only has one anchor point, so the bounds are relative to that of the first vertex
+        uint64_t hash = static_cast<uint64_t>(item.texture) << 8 | static_cast<uint64_t>(item.type);
+        glm::ivec2 min = glm::ivec2(INT16_MAX);
+        glm::ivec2 max = glm::ivec2(INT16_MIN);
+        if (item.type == BatchType::instances) {
+            const Instance* instances = &list.instances[item.first_vertex];
+            hash = hash_bytes(instances, item.n_vertices * sizeof(Instance), hash);
+            item.anchor = static_cast<AnchorPoint>(instances[0].anchor);
+            for (uint32_t i = 0; i < item.n_vertices; ++i) {
+                // Lines and outlines reach past the rectangle by their width, and antialiasing adds another pixel
+                const glm::ivec2 a = { instances[i].rect[0], instances[i].rect[1] };
+                const glm::ivec2 b = { instances[i].rect[2], instances[i].rect[3] };
+                const int margin = instances[i].width + 2 * static_cast<int>(VERTEX_POSITION_SCALE);
+                min = glm::min(min, glm::min(a, b) - margin);
+                max = glm::max(max, glm::max(a, b) + margin);
+            }
+        }
+        else {
+            const PackedVertex* vertices = &list.vertices[item.first_vertex];
+            hash = hash_bytes(vertices, item.n_vertices * sizeof(PackedVertex), hash);
+            item.anchor = static_cast<AnchorPoint>(vertices[0].anchor);
+            hash = hash_bytes(list.indices.data() + item.first_index, item.n_indices * sizeof(uint16_t), hash);
+            for (uint32_t i = 0; i < item.n_vertices; ++i) {
+                min = glm::min(min, glm::ivec2(vertices[i].x, vertices[i].y));
+                max = glm::max(max, glm::ivec2(vertices[i].x, vertices[i].y));
+            }
+        }
+        item.hash = hash;
+        item.bounds = {
+            glm::ivec2(glm::floor(glm::vec2(min) / VERTEX_POSITION_SCALE)) - 1,
+            glm::ivec2(glm::ceil(glm::vec2(max) / VERTEX_POSITION_SCALE)) + 1,
+        };
+    }
+
+    glm::ivec4 Renderer::track_damage() {
+        for (auto& item : m_draw_list.draw_items) {
+            // Cached items worked theirs out when they were generated
+            if (!item.cached) item_footprint(m_draw_list, item);
+
+            // The same geometry covers different pixels with a different clip rectangle or offset
+            const glm::ivec4& clip = m_draw_list.clip_rects[item.clip];
+            const glm::ivec2 origin = anchor_origin(item.anchor);
+            const glm::ivec4 bounds = item.bounds + glm::ivec4(origin, origin) + glm::ivec4(glm::floor(item.offset), glm::ceil(item.offset));
+            const uint64_t hash = hash_bytes(&item.offset, sizeof(item.offset), hash_bytes(&clip, sizeof(clip), item.hash));
+            m_damage.add(hash, rect_intersect(bounds, clip));
+        }
+        return m_damage.end_frame(m_res);
+    }
+
+    void Renderer::begin_cache() {
+        DrawList& list = draw_list();
+        if (list.recording_cache) {
+            printf("ERROR: begin_cache() called twice without end_cache()\n");
+            return;
+        }
+
+        // The draw functions append to the frame's arrays, so everything after this point belongs to the cache entry
+        list.cache_start = { list.draw_items.size(), list.vertices.size(), list.indices.size(), list.instances.size() };
+        list.recording_cache = true;
+        list.used_placeholder = false;
+
+        // Only cull against the draw calls' own transforms, the window and clip stack can be different when it's drawn again
+        list.clip_stack.emplace_back(-CACHE_CLIP_EXTENT, -CACHE_CLIP_EXTENT, CACHE_CLIP_EXTENT, CACHE_CLIP_EXTENT);
+    }
+
+    void Renderer::end_cache(uint32_t& handle) {
+        DrawList& list = draw_list();
+        if (!list.recording_cache) {
+            printf("ERROR: end_cache() called without begin_cache()\n");
+            return;
+        }
+        store_cache(handle);
+        draw_cached(handle);
+    }
+
+    void Renderer::store_cache(uint32_t& handle) {
+        DrawList& list = draw_list();
+        AllocationScope allocation_scope(AllocSubsystem::renderer);
+        list.recording_cache = false;
+        list.clip_stack.pop_back();
+
+        // Get an entry. Other threads might be storing or drawing entries at the same time
+        std::lock_guard lock(m_cache_mutex);
+        if (handle >= m_cache_entries.size()) {
+            if (!m_free_cache_entries.empty()) {
+                handle = m_free_cache_entries.back();
+                m_free_cache_entries.pop_back();
+            }
+            else {
+                handle = static_cast<uint32_t>(m_cache_entries.size());
+                m_cache_entries.emplace_back();
+            }
+        }
+        CacheEntry& entry = m_cache_entries[handle];
+
+        // Upload the geometry, replacing what was there before
+        const auto n_new = [](const auto& array, const size_t start) { return static_cast<uint32_t>(array.size() - start); };
+        m_cache_bytes_uploaded += m_cached_vertices.store(list.vertices.data() + list.cache_start.vertices, n_new(list.vertices, list.cache_start.vertices), entry.vertices);
+        m_cache_bytes_uploaded += m_cached_indices.store(list.indices.data() + list.cache_start.indices, n_new(list.indices, list.cache_start.indices), entry.indices);
+        m_cache_bytes_uploaded += m_cached_instances.store(list.instances.data() + list.cache_start.instances, n_new(list.instances, list.cache_start.instances), entry.instances);
+
+        // Move the items over, pointing them at the cache buffers. Their sort keys can be worked out now, since the geometry won't change
+        entry.items.clear();
+        entry.clip_rects.clear();
+        for (size_t i = list.cache_start.items; i < list.draw_items.size(); ++i) {
+            DrawItem item = list.draw_items[i];
+            item.key = sort_key(item, list.vertices.data(), list.instances.data());
+            item_footprint(list, item);
+            const glm::ivec2 clip_origin = anchor_origin(item.clip_anchor);
+            entry.clip_rects.push_back(list.clip_rects[item.clip] - glm::ivec4(clip_origin, clip_origin));
+            if (item.type == BatchType::instances) {
+                item.first_vertex = item.first_vertex - static_cast<uint32_t>(list.cache_start.instances) + entry.instances.offset;
+            }
+            else {
+                item.first_vertex = item.first_vertex - static_cast<uint32_t>(list.cache_start.vertices) + entry.vertices.offset;
+                item.first_index = item.first_index - static_cast<uint32_t>(list.cache_start.indices) + entry.indices.offset;
+            }
+            item.cached = true;
+            entry.items.push_back(item);
+        }
+        entry.valid = true;
+        if (list.used_placeholder) m_placeholder_entries.push_back(handle);
+
+        // Take the geometry back out of this frame's arrays, it's drawn from the cache instead
+        list.draw_items.resize(list.cache_start.items);
+        list.vertices.resize(list.cache_start.vertices);
+        list.indices.resize(list.cache_start.indices);
+        list.instances.resize(list.cache_start.instances);
+    }
+
+    void Renderer::begin_scroll_content() {
+        // Cache entries aren't culled, so nothing is missing when it's scrolled into view later
+        begin_cache();
+    }
+
+    void Renderer::end_scroll_content(uint32_t& handle) {
+        DrawList& list = draw_list();
+        if (!list.recording_cache) {
+            printf("ERROR: end_scroll_content() called without begin_scroll_content()\n");
+            return;
+        }
+        store_cache(handle);
+    }
+
+    bool Renderer::draw_scrolled(const uint32_t handle, const glm::vec2 offset) {
+        DrawList& list = draw_list();
+        std::lock_guard lock(m_cache_mutex);
+        if (handle >= m_cache_entries.size()) return false;
+        AllocationScope allocation_scope(AllocSubsystem::renderer);
+
+        // The clip rectangles it was generated with move along with their anchor points and the offset, and are clipped to whatever it's drawn in
+        const CacheEntry& entry = m_cache_entries[handle];
+        if (!entry.valid) return false;
+        const glm::vec4& stack_top = list.clip_stack.back();
+        if (!set_draw_clip({ stack_top.x, stack_top.y }, { stack_top.z, stack_top.w })) return true;
+
+        const glm::ivec2 clip_offset = glm::ivec2(glm::round(offset));
+        for (size_t i = 0; i < entry.items.size(); ++i) {
+            const glm::ivec2 clip_origin = anchor_origin(entry.items[i].clip_anchor) + clip_offset;
+            const glm::ivec4 clip = rect_intersect(entry.clip_rects[i] + glm::ivec4(clip_origin, clip_origin), list.draw_clip);
+            if (rect_empty(clip)) continue;
+            push_clip_index(clip);
+            DrawItem& item = list.draw_items.emplace_back(entry.items[i]);
+            item.clip = static_cast<uint32_t>(list.clip_rects.size() - 1);
+            item.offset = offset;
+        }
+        return true;
+    }
+
+    bool Renderer::draw_cached(const uint32_t handle) {
+        // The same as scrolled content that isn't scrolled
+        return draw_scrolled(handle, { 0.0f, 0.0f });
+    }
+
+    void Renderer::release_cache(uint32_t& handle) {
+        std::lock_guard lock(m_cache_mutex);
+        if (handle >= m_cache_entries.size()) return;
+        CacheEntry& entry = m_cache_entries[handle];
+        m_cached_vertices.release(entry.vertices);
+        m_cached_indices.release(entry.indices);
+        m_cached_instances.release(entry.instances);
+        entry = {};
+        m_free_cache_entries.push_back(handle);
+        handle = INVALID_CACHE_HANDLE;
+    }
+
+    void Renderer::begin_layer(const glm::vec2 top_left, const glm::vec2 bottom_right, const float depth, const AnchorPoint anchor) {
+        if (t_draw_list) {
+            printf("ERROR: Layers can only be recorded on the main thread\n");
+            return;
+        }
+        if (m_recording_layer || m_draw_list.recording_cache) {
+            printf("ERROR: begin_layer() can't be nested inside another layer or a cache entry\n");
+            return;
+        }
+
+        // Everything in the layer is clipped to it, and the texture covers whole pixels
+        m_layer_parent_clip = m_draw_list.clip_stack.back();
+        push_clip_rect(top_left, bottom_right, anchor);
+        const glm::vec4& clip = m_draw_list.clip_stack.back();
+        m_layer_rect = { glm::ivec2(glm::floor(glm::vec2(clip.x, clip.y))), glm::ivec2(glm::ceil(glm::vec2(clip.z, clip.w))) };
+        m_layer_depth = depth;
+
+        // Like begin_cache(), everything appended to the frame's arrays after this point belongs to the layer
+        m_layer_start = { m_draw_list.draw_items.size(), m_draw_list.vertices.size(), m_draw_list.indices.size(), m_draw_list.instances.size() };
+        m_recording_layer = true;
+    }
+
+    void Renderer::end_layer(uint32_t& handle) {
+        AllocationScope allocation_scope(AllocSubsystem::renderer);
+        if (!m_recording_layer) {
+            printf("ERROR: end_layer() called without begin_layer()\n");
+            return;
+        }
+        m_recording_layer = false;
+        pop_clip_rect();
+
+        // Get an entry
+        if (handle >= m_layers.size()) {
+            if (!m_free_layers.empty()) {
+                handle = m_free_layers.back();
+                m_free_layers.pop_back();
+            }
+            else {
+                handle = static_cast<uint32_t>(m_layers.size());
+                m_layers.emplace_back();
+            }
+        }
+        LayerEntry& layer = m_layers[handle];
+
+        // Only make a new texture when the size changes. The texture is needed right away, since the quad that shows it samples it
+        const glm::ivec2 size = { m_layer_rect.z - m_layer_rect.x, m_layer_rect.w - m_layer_rect.y };
+        if (size != layer.size) {
+            run_on_render_thread([this, &layer, size] {
+                m_backend->destroy_render_target(layer.fbo, layer.color, layer.depth);
+                if (size.x > 0 && size.y > 0) m_backend->create_render_target(size, layer.fbo, layer.color, layer.depth);
+            });
+            layer.size = size;
+        }
 
-        // Render flat triangle queue
-        glUseProgram(m_shader);
-        glBindTexture(GL_TEXTURE_2D, m_font.texture_id);
-        glBindVertexArray(m_vao);
-        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(sizeof(Triangle) * m_flat_queue.size()), m_flat_queue.data(), GL_STATIC_DRAW);
-        glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(m_flat_queue.size() * 3));
+        // Take the layer's items out of the frame. Their geometry stays in the frame's arrays, and they're rendered into the texture before the frame is drawn
+        if (layer.fbo) {
+            const auto n_items = static_cast<uint32_t>(m_draw_list.draw_items.size() - m_layer_start.items);
+            m_layer_passes.push_back({ layer.fbo, m_layer_rect, static_cast<uint32_t>(m_layer_items.size()), n_items });
+            m_layer_items.insert(m_layer_items.end(), m_draw_list.draw_items.begin() + static_cast<ptrdiff_t>(m_layer_start.items), m_draw_list.draw_items.end());
+        }
+        m_draw_list.draw_items.resize(m_layer_start.items);
 
-        // Render textured triangle queue
-        for (auto& entry : m_textured_queue) {
-            glUseProgram(m_shader);
-            glBindTexture(GL_TEXTURE_2D, entry.first);
-            glBindVertexArray(m_vao);
-            glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-            glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(sizeof(Triangle) * entry.second.size()), entry.second.data(), GL_STATIC_DRAW);
-            glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(entry.second.size()) * 3);
+        layer.rect = m_layer_rect;
+        layer.composite_depth = m_layer_depth;
+        layer.resolution = m_res;
+        layer.parent_clip = m_layer_parent_clip;
+        layer.valid = layer.fbo != 0;
+
+        // The quad that shows the layer looks the same to the damage tracker no matter what's in the texture
+        m_damage.add_damage(layer.rect);
+        draw_layer(handle);
+    }
+
+    bool Renderer::draw_layer(const uint32_t handle) {
+        if (t_draw_list || handle >= m_layers.size()) return false;
+
+        // Same rules as cache entries, the contents were clipped and positioned for this resolution and clip rectangle
+        const LayerEntry& layer = m_layers[handle];
+        if (!layer.valid || layer.resolution != m_res || layer.parent_clip != m_draw_list.clip_stack.back()) return false;
+
+        const glm::vec2 tl = { layer.rect.x, layer.rect.y };
+        const glm::vec2 br = { layer.rect.z, layer.rect.w };
+        if (!set_draw_clip(tl, br)) return true;
+
+        // OpenGL puts the first row of a render target at the bottom, so the texture is upside down
+        *push_instances(1, layer.color) = pack_instance(InstanceKind::layer, tl, br, layer.composite_depth, { 0, 1 }, { 1, 0 }, { 1, 1, 1, 1 }, AnchorPoint::top_left);
+        return true;
+    }
+
+    void Renderer::release_layer(uint32_t& handle) {
+        if (handle >= m_layers.size()) return;
+        LayerEntry& layer = m_layers[handle];
+        run_on_render_thread([this, &layer] { m_backend->destroy_render_target(layer.fbo, layer.color, layer.depth); });
+        layer = {};
+        m_free_layers.push_back(handle);
+        handle = INVALID_CACHE_HANDLE;
+    }
+
+    bool Renderer::set_draw_clip(const glm::vec2 top_left, const glm::vec2 bottom_right, const AnchorPoint anchor) {
+        DrawList& list = draw_list();
+        // Intersect with the top of the clip stack
+        const glm::vec4& stack_top = list.clip_stack.back();
+        const glm::vec2 tl = glm::max(apply_anchor_in_pixel_space(top_left, anchor), glm::vec2(stack_top.x, stack_top.y));
+        const glm::vec2 br = glm::min(apply_anchor_in_pixel_space(bottom_right, anchor), glm::vec2(stack_top.z, stack_top.w));
+        list.draw_clip_anchor = anchor;
+
+        // Round to the pixels whose centers are inside the rectangle. Returns false if there are none
+        const auto first = glm::ivec2(glm::ceil(tl - 0.5f));
+        const glm::ivec2 end = glm::ivec2(glm::floor(br - 0.5f)) + 1;
+        list.draw_clip = { first, glm::max(end, first) };
+        return end.x > first.x && end.y > first.y;
+    }
+
+    bool Renderer::is_visible(const glm::vec2 top_left, const glm::vec2 bottom_right) const {
+        const DrawList& list = draw_list();
+        return bottom_right.x > static_cast<float>(list.draw_clip.x) && bottom_right.y > static_cast<float>(list.draw_clip.y)
+            && top_left.x < static_cast<float>(list.draw_clip.z) && top_left.y < static_cast<float>(list.draw_clip.w);
+    }
+
+    void Renderer::push_clip_rect(const glm::vec2 top_left, const glm::vec2 bottom_right, const AnchorPoint anchor) {
+        DrawList& list = draw_list();
+        AllocationScope allocation_scope(AllocSubsystem::renderer);
+        // Nested rectangles can only make the clipped area smaller
+        const glm::vec4& parent = list.clip_stack.back();
+        const glm::vec2 tl = glm::max(apply_anchor_in_pixel_space(top_left, anchor), glm::vec2(parent.x, parent.y));
+        const glm::vec2 br = glm::max(glm::min(apply_anchor_in_pixel_space(bottom_right, anchor), glm::vec2(parent.z, parent.w)), tl);
+        list.clip_stack.emplace_back(tl, br);
+    }
+
+    void Renderer::pop_clip_rect() {
+        DrawList& list = draw_list();
+        if (list.clip_stack.size() <= 1) {
+            printf("ERROR: pop_clip_rect() without a matching push_clip_rect()\n");
+            return;
         }
-        flip_buffers();
+        list.clip_stack.pop_back();
     }
 
     void Renderer::flip_buffers() const {
-        glfwSwapBuffers(m_window);
+        if (m_window) glfwSwapBuffers(m_window);
     }
 
     void Renderer::draw_line(Transform transform, glm::vec2 a, glm::vec2 b, glm::vec4 color, float width, float depth, AnchorPoint anchor) {
-        Vertex v1{}, v2{}, v3{}, v4{};
-
-        // Calculate normal
-        glm::vec2 normal = (b - a);
-        normal = { -normal.y, normal.x };
-        normal = glm::normalize(normal) * width;
-
-        // Create triangles
-        v1.pos = glm::vec3(pixels_to_normalized(a - normal, anchor), depth);
-        v2.pos = glm::vec3(pixels_to_normalized(b - normal, anchor), depth);
-        v3.pos = glm::vec3(pixels_to_normalized(b + normal, anchor), depth);
-        v4.pos = glm::vec3(pixels_to_normalized(a + normal, anchor), depth);
-        v1.tc = { 0, 0 };
-        v2.tc = { 0, 0 };
-        v3.tc = { 0, 0 };
-        v4.tc = { 0, 0 };
-        v1.color = color;
-        v2.color = color;
-        v3.color = color;
-        v4.color = color;
-        v1.clip_rect = { transform.top_left.x, transform.top_left.y, transform.bottom_right.x, transform.bottom_right.y };
-        v2.clip_rect = { transform.top_left.x, transform.top_left.y, transform.bottom_right.x, transform.bottom_right.y };
-        v3.clip_rect = { transform.top_left.x, transform.top_left.y, transform.bottom_right.x, transform.bottom_right.y };
-        v4.clip_rect = { transform.top_left.x, transform.top_left.y, transform.bottom_right.x, transform.bottom_right.y };
-        m_flat_queue.push_back({v1, v3, v2});
-        m_flat_queue.push_back({v1, v4, v3});
+        const LineCmd line{ a, b, color, width, depth };
+        draw_lines(transform, { &line, 1 }, anchor);
     }
 
     void Renderer::draw_box_line(Transform transform, const glm::vec2 top_left, const glm::vec2 bottom_right, const glm::vec4 color, const float width, const float depth, AnchorPoint anchor) {
+        // A single outline instead of four lines
+        if (m_use_instancing) {
+            draw_rounded_box_line(transform, top_left, bottom_right, 0.0f, color, width, depth, anchor);
+            return;
+        }
+
         // Derive corners of the box
         const glm::vec2 tl = top_left;
         const glm::vec2 br = bottom_right;
         const glm::vec2 bl = { tl.x, br.y };
         const glm::vec2 tr = { br.x, tl.y };
 
-        // Draw the lines
-        const glm::vec2 x = { width, 0 };
-        const glm::vec2 y = { x.y, x.x };
-        draw_line(transform, tl - x, tr + x, color, width, depth, anchor);
-        draw_line(transform, tr + y, br - y, color, width, depth, anchor);
-        draw_line(transform, br + x, bl - x, color, width, depth, anchor);
-        draw_line(transform, bl - y, tl + y, color, width, depth, anchor);
+        // Draw the outline as one closed stroke
+        const glm::vec2 corners[] = { tl, tr, br, bl };
+        draw_polyline(transform, corners, 4, color, width, depth, true, LineJoin::miter, anchor);
     }
 
     void Renderer::draw_circle_line(const Transform transform, const glm::vec2 center, const glm::vec2 scale, const glm::vec4 color, const float width, const float depth, AnchorPoint anchor) {
-        glm::vec2 points[SINE_LUT_RESOLUTION];
+        // Skip circles that are entirely clipped, before generating any points
+        const glm::vec2 top_left = apply_anchor_in_pixel_space(center - scale, anchor);
+        const glm::vec2 bottom_right = apply_anchor_in_pixel_space(center + scale, anchor);
+        if (!set_draw_clip(transform.top_left, transform.bottom_right, transform.anchor) || !is_visible(top_left - (width + 1.0f), bottom_right + (width + 1.0f))) return;
 
-        // Generate points
-        for (size_t i = 0; i < SINE_LUT_RESOLUTION; i++) {
-            const size_t sx = i;
-            const size_t cx = (sx + (SINE_LUT_RESOLUTION / 4)) % SINE_LUT_RESOLUTION;
-            points[i] = center + (scale * glm::vec2{ m_sine_lut[cx], m_sine_lut[sx]});
+        if (m_use_instancing) {
+            *push_instances(1, 0) = pack_instance(InstanceKind::ellipse_line, center - scale, center + scale, depth, {}, {}, color, anchor, width);
+            return;
         }
 
-        // Draw lines
-        for (int i = 0; i < SINE_LUT_RESOLUTION; i++) {
-            draw_line(transform, points[i], points[(i + 1) % SINE_LUT_RESOLUTION], color, width, depth, anchor);
+        // Generate points, with as many segments as the size on screen needs
+        const std::vector<glm::vec2>& circle = unit_circle(circle_segments(std::max(scale.x, scale.y)));
+        glm::vec2 points[256];
+        for (size_t i = 0; i < circle.size(); i++) {
+            points[i] = center + scale * circle[i];
         }
+
+        // Draw them as one closed stroke
+        draw_polyline(transform, points, circle.size(), color, width, depth, true, LineJoin::miter, anchor);
     }
 
     void Renderer::draw_circle_solid(const Transform transform, const glm::vec2 center, const glm::vec2 scale, const glm::vec4 color, const float depth, const AnchorPoint anchor) {
-        glm::vec2 points[SINE_LUT_RESOLUTION];
-
-        // Generate points
-        for (size_t i = 0; i < SINE_LUT_RESOLUTION; i++) {
-            const size_t sx = i;
-            const size_t cx = (sx + (SINE_LUT_RESOLUTION / 4)) % SINE_LUT_RESOLUTION;
-            points[i] = center + (scale * glm::vec2{ m_sine_lut[cx], m_sine_lut[sx] });
+        DrawList& list = draw_list();
+        // Skip circles that are entirely clipped, before generating any points
+        const glm::vec2 top_left = apply_anchor_in_pixel_space(center - scale, anchor);
+        const glm::vec2 bottom_right = apply_anchor_in_pixel_space(center + scale, anchor);
+        if (!set_draw_clip(transform.top_left, transform.bottom_right, transform.anchor) || !is_visible(top_left - 1.0f, bottom_right + 1.0f)) return;
+
+        if (m_use_instancing) {
+            *push_instances(1, 0) = pack_instance(InstanceKind::ellipse, center - scale, center + scale, depth, {}, {}, color, anchor);
+            return;
         }
 
-        // Generate polygon
-        Vertex verts[SINE_LUT_RESOLUTION];
-        for (size_t i = 0; i < SINE_LUT_RESOLUTION; i++) {
-            verts[i] = Vertex{glm::vec3(points[i], depth), {0, 0}, color};
+        // Generate polygon, with as many segments as the size on screen needs
+        const std::vector<glm::vec2>& circle = unit_circle(circle_segments(std::max(scale.x, scale.y)));
+        list.polygon_scratch.clear();
+        for (const auto& point : circle) {
+            list.polygon_scratch.push_back(Vertex{ glm::vec3(center + scale * point, depth), {0, 0}, color });
         }
 
         // Draw polygon
-        draw_flat_polygon(transform, verts, SINE_LUT_RESOLUTION, anchor);
+        draw_flat_polygon(transform, list.polygon_scratch.data(), list.polygon_scratch.size(), anchor);
     }
 
-    void Renderer::draw_box_solid(Transform transform, const glm::vec2 top_left, const glm::vec2 bottom_right, const glm::vec4 color, float depth, const AnchorPoint anchor) {
-        // Derive corners of the box
-        glm::vec2 tl = top_left;
-        glm::vec2 br = bottom_right;
-        glm::vec2 bl = { tl.x, br.y };
-        glm::vec2 tr = { br.x, tl.y };
+    int Renderer::circle_segments(const float radius) {
+        // Enough segments that the polygon is never more than a quarter of a pixel away from the real circle
+        constexpr float tolerance = 0.25f;
+        if (radius <= tolerance) return 8;
+        const float segment_angle = 2.0f * acosf(1.0f - tolerance / radius);
+        const int n_segments = static_cast<int>(ceilf(6.283185307179f / segment_angle));
 
-        // Create vertices
-        Vertex verts[] = {
-            { {tl, depth}, {1, 1}, color },
-            { {tr, depth}, {1, 0}, color },
-            { {br, depth}, {0, 1}, color },
-            { {bl, depth}, {0, 0}, color }
+        // Round up to a multiple of 4, so the table is symmetrical
+        return std::clamp((n_segments + 3) / 4 * 4, 8, 256);
+    }
+
+    const std::vector<glm::vec2>& Renderer::unit_circle(const int n_segments) {
+        // Map elements stay where they are, so the table can be used after unlocking
+        std::lock_guard lock(m_unit_circle_mutex);
+        std::vector<glm::vec2>& table = m_unit_circles[n_segments];
+        if (table.empty()) {
+            const float step = 6.283185307179f / static_cast<float>(n_segments);
+            table.resize(n_segments);
+            for (int i = 0; i < n_segments; i++) {
+                const float angle = static_cast<float>(i) * step;
+                table[i] = { cosf(angle), sinf(angle) };
+            }
+        }
+        return table;
+    }
+
+    void Renderer::draw_polyline(Transform transform, const glm::vec2* points, const size_t n_points, const glm::vec4 color, const float width, const float depth, const bool closed, const LineJoin join, const AnchorPoint anchor) {
+        DrawList& list = draw_list();
+        // Drop repeated points, since they don't have a direction
+        list.stroke_points.clear();
+        for (size_t i = 0; i < n_points; i++) {
+            const glm::vec2 point = points[i];
+            if (list.stroke_points.empty() || glm::distance(list.stroke_points.back(), point) > 0.001f) {
+                list.stroke_points.push_back(point);
+            }
+        }
+        if (closed && list.stroke_points.size() > 2 && glm::distance(list.stroke_points.front(), list.stroke_points.back()) <= 0.001f) {
+            list.stroke_points.pop_back();
+        }
+        if (list.stroke_points.size() < 2) return;
+
+        // Skip the whole stroke if it's clipped. Joins can stick out up to the miter limit
+        glm::vec2 bounds_min = list.stroke_points[0];
+        glm::vec2 bounds_max = list.stroke_points[0];
+        for (const auto& point : list.stroke_points) {
+            bounds_min = glm::min(bounds_min, point);
+            bounds_max = glm::max(bounds_max, point);
+        }
+        const float margin = width * MITER_LIMIT + 1.0f;
+        if (!set_draw_clip(transform.top_left, transform.bottom_right, transform.anchor)
+            || !is_visible(apply_anchor_in_pixel_space(bounds_min, anchor) - margin, apply_anchor_in_pixel_space(bounds_max, anchor) + margin)) return;
+
+        // Tessellate in runs, so every run fits in a single indexed draw
+        const size_t n_segments = closed ? list.stroke_points.size() : list.stroke_points.size() - 1;
+        for (size_t first_segment = 0; first_segment < n_segments; first_segment += POLYLINE_RUN_SEGMENTS) {
+            tessellate_stroke(first_segment, std::min(first_segment + POLYLINE_RUN_SEGMENTS, n_segments), closed, width, join);
+
+            uint16_t* indices = nullptr;
+            PackedVertex* out = push_indexed(list.stroke_positions.size(), list.stroke_indices.size(), 0, indices);
+            for (size_t i = 0; i < list.stroke_positions.size(); i++) {
+                out[i] = pack_vertex(list.stroke_positions[i], depth, { 0, 0 }, color, anchor);
+            }
+            for (size_t i = 0; i < list.stroke_indices.size(); i++) {
+                indices[i] = list.stroke_indices[i];
+            }
+        }
+    }
+
+    void Renderer::tessellate_stroke(const size_t first_segment, const size_t end_segment, const bool closed, const float width, const LineJoin join) {
+        DrawList& list = draw_list();
+        const std::vector<glm::vec2>& points = list.stroke_points;
+        const size_t n_points = points.size();
+        list.stroke_positions.clear();
+        list.stroke_indices.clear();
+        const auto add = [&](const glm::vec2 pos) {
+            list.stroke_positions.push_back(pos);
+            return static_cast<uint16_t>(list.stroke_positions.size() - 1);
         };
-        draw_flat_polygon(transform, verts, 4, anchor);
+        const auto perpendicular = [](const glm::vec2 v) { return glm::vec2(-v.y, v.x); };
+
+        // Every point gets a left and right vertex where the previous segment ends, and where the next one starts.
+        // Those are the same vertices, unless there's a bevel or round join between them.
+        uint16_t prev_left = 0, prev_right = 0;
+        for (size_t p = first_segment; p <= end_segment; p++) {
+            const size_t i = p % n_points;
+            const glm::vec2 pos = points[i];
+            const bool has_in = closed || p > 0;
+            const bool has_out = closed || p < n_points - 1;
+
+            // Directions of the segments before and after this point. Open ends just continue straight
+            glm::vec2 dir_in = has_in ? glm::normalize(pos - points[(i + n_points - 1) % n_points]) : glm::vec2();
+            glm::vec2 dir_out = has_out ? glm::normalize(points[(i + 1) % n_points] - pos) : glm::vec2();
+            if (!has_in) dir_in = dir_out;
+            if (!has_out) dir_out = dir_in;
+            const glm::vec2 normal_in = perpendicular(dir_in);
+            const glm::vec2 normal_out = perpendicular(dir_out);
+
+            uint16_t in_left, in_right, out_left, out_right;
+            const float turn = glm::dot(normal_in, dir_out);
+            if (fabsf(turn) < 0.0001f && glm::dot(dir_in, dir_out) > 0.0f) {
+                // Straight through
+                in_left = out_left = add(pos + normal_in * width);
+                in_right = out_right = add(pos - normal_in * width);
+            }
+            else {
+                // When the path doubles back on itself, the miter points along the path
+                glm::vec2 miter = normal_in + normal_out;
+                const float miter_length = glm::length(miter);
+                miter = miter_length > 0.0001f ? miter / miter_length : dir_in;
+                const float miter_scale = 1.0f / std::max(glm::dot(miter, normal_out), 0.0001f);
+
+                if (join == LineJoin::miter && miter_scale <= MITER_LIMIT) {
+                    in_left = out_left = add(pos + miter * (width * miter_scale));
+                    in_right = out_right = add(pos - miter * (width * miter_scale));
+                }
+                else {
+                    // The path turns towards the inner side, the outer side gets the join
+                    const float outer_side = turn > 0.0f ? -1.0f : 1.0f;
+                    const uint16_t inner = add(pos - outer_side * miter * (width * std::min(miter_scale, MITER_LIMIT)));
+                    const uint16_t outer_in = add(pos + outer_side * normal_in * width);
+
+                    // Arc points for round joins, rotated out of the cached unit circle
+                    const size_t arc_start = list.stroke_positions.size();
+                    if (join == LineJoin::round) {
+                        const std::vector<glm::vec2>& circle = unit_circle(std::min(circle_segments(width), 64));
+                        const float step = 6.283185307179f / static_cast<float>(circle.size());
+                        const float angle = acosf(std::clamp(glm::dot(dir_in, dir_out), -1.0f, 1.0f));
+                        const glm::vec2 start = outer_side * normal_in * width;
+                        const float direction = (dir_in.x * dir_out.y - dir_in.y * dir_out.x) > 0.0f ? 1.0f : -1.0f;
+                        for (size_t k = 1; static_cast<float>(k) * step < angle; k++) {
+                            const glm::vec2 cs = circle[k];
+                            add(pos + glm::vec2(start.x * cs.x - direction * start.y * cs.y, direction * start.x * cs.y + start.y * cs.x));
+                        }
+                    }
+                    const size_t arc_end = list.stroke_positions.size();
+                    const uint16_t outer_out = add(pos + outer_side * normal_out * width);
+
+                    // Fill the gap on the outside of the turn with a fan around the inner point. Only the run containing the outgoing segment does this
+                    if (p < end_segment && has_in && has_out) {
+                        uint16_t prev = outer_in;
+                        for (size_t k = arc_start; k <= arc_end; k++) {
+                            const uint16_t next = k == arc_end ? outer_out : static_cast<uint16_t>(k);
+                            list.stroke_indices.insert(list.stroke_indices.end(), { inner, prev, next });
+                            prev = next;
+                        }
+                    }
+
+                    if (outer_side > 0.0f) {
+                        in_left = outer_in;
+                        out_left = outer_out;
+                        in_right = out_right = inner;
+                    }
+                    else {
+                        in_right = outer_in;
+                        out_right = outer_out;
+                        in_left = out_left = inner;
+                    }
+                }
+            }
+
+            // Connect to the previous point
+            if (p > first_segment) {
+                list.stroke_indices.insert(list.stroke_indices.end(), { prev_left, prev_right, in_right });
+                list.stroke_indices.insert(list.stroke_indices.end(), { prev_left, in_right, in_left });
+            }
+            prev_left = out_left;
+            prev_right = out_right;
+        }
+    }
+
+    void Renderer::draw_rounded_box_solid(Transform transform, const glm::vec2 top_left, const glm::vec2 bottom_right, const float radius, const glm::vec4 color, const float depth, const AnchorPoint anchor) {
+        // Without instancing the corners stay square
+        if (!m_use_instancing) {
+            draw_box_solid(transform, top_left, bottom_right, color, depth, anchor);
+            return;
+        }
+
+        const glm::vec2 tl = apply_anchor_in_pixel_space(top_left, anchor);
+        const glm::vec2 br = apply_anchor_in_pixel_space(bottom_right, anchor);
+        if (!set_draw_clip(transform.top_left, transform.bottom_right, transform.anchor) || !is_visible(tl - 1.0f, br + 1.0f)) return;
+        *push_instances(1, 0) = pack_instance(InstanceKind::rounded_rect, top_left, bottom_right, depth, {}, {}, color, anchor, 0.0f, radius);
+    }
+
+    void Renderer::draw_rounded_box_line(Transform transform, const glm::vec2 top_left, const glm::vec2 bottom_right, const float radius, const glm::vec4 color, const float width, const float depth, const AnchorPoint anchor) {
+        // Without instancing the corners stay square
+        if (!m_use_instancing) {
+            draw_box_line(transform, top_left, bottom_right, color, width, depth, anchor);
+            return;
+        }
+
+        const glm::vec2 tl = apply_anchor_in_pixel_space(top_left, anchor);
+        const glm::vec2 br = apply_anchor_in_pixel_space(bottom_right, anchor);
+        if (!set_draw_clip(transform.top_left, transform.bottom_right, transform.anchor) || !is_visible(tl - (width + 1.0f), br + (width + 1.0f))) return;
+        *push_instances(1, 0) = pack_instance(InstanceKind::rounded_rect_line, top_left, bottom_right, depth, {}, {}, color, anchor, width, radius);
+    }
+
+    void Renderer::draw_capsule(Transform transform, const glm::vec2 a, const glm::vec2 b, const glm::vec4 color, const float radius, const float depth, const AnchorPoint anchor) {
+        // Without instancing the caps stay square
+        if (!m_use_instancing) {
+            draw_line(transform, a, b, color, radius, depth, anchor);
+            return;
+        }
+
+        const glm::vec2 anchored_a = apply_anchor_in_pixel_space(a, anchor);
+        const glm::vec2 anchored_b = apply_anchor_in_pixel_space(b, anchor);
+        if (!set_draw_clip(transform.top_left, transform.bottom_right, transform.anchor) || !is_visible(glm::min(anchored_a, anchored_b) - (radius + 1.0f), glm::max(anchored_a, anchored_b) + (radius + 1.0f))) return;
+        *push_instances(1, 0) = pack_instance(InstanceKind::capsule, a, b, depth, {}, {}, color, anchor, radius);
+    }
+
+    void Renderer::draw_box_solid(Transform transform, const glm::vec2 top_left, const glm::vec2 bottom_right, const glm::vec4 color, float depth, const AnchorPoint anchor) {
+        const RectCmd rect{ top_left, bottom_right, color, depth };
+        draw_rects(transform, { &rect, 1 }, anchor);
     }
 
     void Renderer::draw_box_textured(Transform transform, const::std::string& texture, TextureType tex_type, const glm::vec2 top_left, const glm::vec2 bottom_right, const glm::vec4 color = { 1,1,1,1 }, float depth, AnchorPoint anchor) {
-        get_texture(texture);
+        // Skip boxes that are entirely clipped, before looking up the texture
+        if (!set_draw_clip(transform.top_left, transform.bottom_right, transform.anchor)
+            || !is_visible(apply_anchor_in_pixel_space(top_left, anchor), apply_anchor_in_pixel_space(bottom_right, anchor))) return;
+        const Texture& tex = get_texture(texture);
 
         // Derive corners of the box
         glm::vec2 tl = top_left;
@@ -460,129 +1257,173 @@ namespace Flan {
                 { {br, depth}, {1, 0}, color * glm::vec4(1, 1, 1, 0) },
                 { {bl, depth}, {0, 0}, color * glm::vec4(1, 1, 1, 0) },
             };
-            draw_polygon_textured(transform, verts, 4, texture, anchor);
+            draw_polygon_textured(transform, verts, 4, tex, anchor);
         }
         else if (tex_type == TextureType::tile) {
-            const glm::vec2 tc_multiplier = {
-                (tr.x - tl.x) / static_cast<float>(m_textures[texture].res.x),
-                (bl.y - tl.y) / static_cast<float>(m_textures[texture].res.y),
-            };
-            Vertex verts[4]{
-                { {tl, depth}, glm::vec2{0, 0} *tc_multiplier, color * glm::vec4(1, 1, 1, 0) },
-                { {tr, depth}, glm::vec2{1, 0} *tc_multiplier, color * glm::vec4(1, 1, 1, 0)},
-                { {br, depth}, glm::vec2{1, -1} *tc_multiplier, color * glm::vec4(1, 1, 1, 0) },
-                { {bl, depth}, glm::vec2{0, -1} *tc_multiplier, color * glm::vec4(1, 1, 1, 0) } ,
-            };
-            draw_polygon_textured(transform, verts, 4, texture, anchor);
+            if (tex.res.x <= 0 || tex.res.y <= 0) return;
+
+            // Texture coordinates can't go outside of the texture's region in the atlas, so repeat it by drawing a quad per tile
+            const auto tile_size = glm::vec2(tex.res);
+            for (float y = tl.y; y < br.y; y += tile_size.y) {
+                for (float x = tl.x; x < br.x; x += tile_size.x) {
+                    const glm::vec2 tile_tl = { x, y };
+                    const glm::vec2 tile_br = glm::min(tile_tl + tile_size, br);
+                    const glm::vec2 fraction = (tile_br - tile_tl) / tile_size;
+                    Vertex verts[4]{
+                        { {tile_tl, depth}, {0, 1}, color * glm::vec4(1, 1, 1, 0) },
+                        { {tile_br.x, tile_tl.y, depth}, {fraction.x, 1}, color * glm::vec4(1, 1, 1, 0) },
+                        { {tile_br, depth}, {fraction.x, 1 - fraction.y}, color * glm::vec4(1, 1, 1, 0) },
+                        { {tile_tl.x, tile_br.y, depth}, {0, 1 - fraction.y}, color * glm::vec4(1, 1, 1, 0) },
+                    };
+                    draw_polygon_textured(transform, verts, 4, tex, anchor);
+                }
+            }
+        }
+        else if (tex_type == TextureType::slice && m_use_instancing) {
+            // One quad, the shader keeps the borders at a third of the texture
+            Instance instance = pack_instance(InstanceKind::nine_slice, tl, br, depth, tex.uv_offset, tex.uv_offset + tex.uv_scale, color * glm::vec4(1, 1, 1, 0), anchor);
+            const glm::ivec2 border = glm::min(tex.res / 3, glm::ivec2(255));
+            instance.insets[0] = static_cast<uint8_t>(border.x);
+            instance.insets[1] = static_cast<uint8_t>(border.y);
+            instance.insets[2] = static_cast<uint8_t>(border.x);
+            instance.insets[3] = static_cast<uint8_t>(border.y);
+            *push_instances(1, tex.id) = instance;
         }
         else if (tex_type == TextureType::slice) {
             // Split into 9 segments
             constexpr float one_third = 1.0f / 3.0f;
             constexpr float two_third = 2.0f / 3.0f;
-            const auto tres = glm::vec2(m_textures[texture].res);
+            const auto tres = glm::vec2(tex.res);
             // Top left
             Vertex verts[4];
             verts[0] = { {tl, depth}, {0, 0}, color * glm::vec4(1, 1, 1, 0)};
             verts[1] = { {tl + tres * glm::vec2(one_third, 0), depth}, {one_third, 0}, color * glm::vec4(1, 1, 1, 0) };
             verts[2] = { {tl + tres * glm::vec2(one_third, one_third), depth}, {one_third, one_third}, color * glm::vec4(1, 1, 1, 0) };
             verts[3] = { {tl + tres * glm::vec2(0, one_third), depth}, {0, one_third}, color * glm::vec4(1, 1, 1, 0) };
-            draw_polygon_textured(transform, verts, 4, texture, anchor);
+            draw_polygon_textured(transform, verts, 4, tex, anchor);
 
             // Top right
             verts[0] = { {tr + tres * glm::vec2(-one_third, 0), depth}, {two_third, 0}, color * glm::vec4(1, 1, 1, 0) };
             verts[1] = { {tr + tres * glm::vec2(0, 0), depth}, {1, 0}, color * glm::vec4(1, 1, 1, 0) };
             verts[2] = { {tr + tres * glm::vec2(0, one_third), depth}, {1, one_third}, color * glm::vec4(1, 1, 1, 0) };
             verts[3] = { {tr + tres * glm::vec2(-one_third, one_third), depth}, {two_third, one_third}, color * glm::vec4(1, 1, 1, 0) };
-            draw_polygon_textured(transform, verts, 4, texture, anchor);
+            draw_polygon_textured(transform, verts, 4, tex, anchor);
 
             // Bottom left
             verts[0] = { {bl + tres * glm::vec2(0, -one_third), depth}, {0, two_third}, color * glm::vec4(1, 1, 1, 0) };
             verts[1] = { {bl + tres * glm::vec2(one_third, -one_third), depth}, {one_third, two_third}, color * glm::vec4(1, 1, 1, 0) };
             verts[2] = { {bl + tres * glm::vec2(one_third, 0), depth}, {one_third, 1}, color * glm::vec4(1, 1, 1, 0) };
             verts[3] = { {bl + tres * glm::vec2(0, 0), depth}, {0, 1}, color * glm::vec4(1, 1, 1, 0) };
-            draw_polygon_textured(transform, verts, 4, texture, anchor);
+            draw_polygon_textured(transform, verts, 4, tex, anchor);
 
             // Bottom right
             verts[0] = { {br + tres * glm::vec2(-one_third, -one_third), depth}, {two_third, two_third}, color * glm::vec4(1, 1, 1, 0) };
             verts[1] = { {br + tres * glm::vec2(0, -one_third), depth}, {1, two_third}, color * glm::vec4(1, 1, 1, 0) };
             verts[2] = { {br + tres * glm::vec2(0, 0), depth}, {1, 1}, color * glm::vec4(1, 1, 1, 0) };
             verts[3] = { {br + tres * glm::vec2(-one_third, 0), depth}, {two_third, 1}, color * glm::vec4(1, 1, 1, 0) };
-            draw_polygon_textured(transform, verts, 4, texture, anchor);
+            draw_polygon_textured(transform, verts, 4, tex, anchor);
 
             // Top
             verts[0] = { {tl + tres * glm::vec2(one_third, 0), depth}, {one_third, 0}, color * glm::vec4(1, 1, 1, 0) };
             verts[1] = { {tr + tres * glm::vec2(-one_third, 0), depth}, {two_third, 0}, color * glm::vec4(1, 1, 1, 0) };
             verts[2] = { {tr + tres * glm::vec2(-one_third, one_third), depth}, {two_third, one_third}, color * glm::vec4(1, 1, 1, 0) };
             verts[3] = { {tl + tres * glm::vec2(one_third, one_third), depth}, {one_third, one_third}, color * glm::vec4(1, 1, 1, 0) };
-            draw_polygon_textured(transform, verts, 4, texture, anchor);
+            draw_polygon_textured(transform, verts, 4, tex, anchor);
 
             // Bottom
             verts[0] = { {bl + tres * glm::vec2(one_third, -one_third), depth}, {one_third, two_third}, color * glm::vec4(1, 1, 1, 0) };
             verts[1] = { {br + tres * glm::vec2(-one_third, -one_third), depth}, {two_third, two_third}, color * glm::vec4(1, 1, 1, 0) };
             verts[2] = { {br + tres * glm::vec2(-one_third, 0), depth}, {two_third, 1}, color * glm::vec4(1, 1, 1, 0) };
             verts[3] = { {bl + tres * glm::vec2(one_third, 0), depth}, {one_third, 1}, color * glm::vec4(1, 1, 1, 0) };
-            draw_polygon_textured(transform, verts, 4, texture, anchor);
+            draw_polygon_textured(transform, verts, 4, tex, anchor);
 
             // Left
             verts[0] = { {tl + tres * glm::vec2(0, one_third), depth}, {0, one_third}, color * glm::vec4(1, 1, 1, 0) };
             verts[1] = { {tl + tres * glm::vec2(one_third, one_third), depth}, {one_third, one_third}, color * glm::vec4(1, 1, 1, 0) };
             verts[2] = { {bl + tres * glm::vec2(one_third, -one_third), depth}, {one_third, two_third}, color * glm::vec4(1, 1, 1, 0) };
             verts[3] = { {bl + tres * glm::vec2(0, -one_third), depth}, {0, two_third}, color * glm::vec4(1, 1, 1, 0) };
-            draw_polygon_textured(transform, verts, 4, texture, anchor);
+            draw_polygon_textured(transform, verts, 4, tex, anchor);
 
             // Right
             verts[0] = { {tr + tres * glm::vec2(-one_third, one_third), depth}, {two_third, one_third}, color * glm::vec4(1, 1, 1, 0) };
             verts[1] = { {tr + tres * glm::vec2(0, one_third), depth}, {1, one_third}, color * glm::vec4(1, 1, 1, 0) };
             verts[2] = { {br + tres * glm::vec2(0, -one_third), depth}, {1, two_third}, color * glm::vec4(1, 1, 1, 0) };
             verts[3] = { {br + tres * glm::vec2(-one_third, -one_third), depth}, {two_third, two_third}, color * glm::vec4(1, 1, 1, 0) };
-            draw_polygon_textured(transform, verts, 4, texture, anchor);
+            draw_polygon_textured(transform, verts, 4, tex, anchor);
 
             // Middle
             verts[0] = { {tl + tres * glm::vec2(one_third, one_third), depth}, {one_third, one_third}, color * glm::vec4(1, 1, 1, 0) };
             verts[1] = { {tr + tres * glm::vec2(-one_third, one_third), depth}, {two_third, one_third}, color * glm::vec4(1, 1, 1, 0) };
             verts[2] = { {br + tres * glm::vec2(-one_third, -one_third), depth}, {two_third, two_third}, color * glm::vec4(1, 1, 1, 0) };
             verts[3] = { {bl + tres * glm::vec2(one_third, -one_third), depth}, {one_third, two_third}, color * glm::vec4(1, 1, 1, 0) };
-            draw_polygon_textured(transform, verts, 4, texture, anchor);
+            draw_polygon_textured(transform, verts, 4, tex, anchor);
         }
 
     }
 
-    void Renderer::draw_flat_polygon(Transform transform, Vertex* verts, size_t n_verts, const AnchorPoint anchor) {
-        // Scale to screen
-        for (size_t i = 0; i < n_verts; i++) {
-            verts[i].pos = pixels_to_normalized(verts[i].pos, anchor);
-            verts[i].clip_rect = { apply_anchor_in_pixel_space(transform.top_left, transform.anchor), apply_anchor_in_pixel_space(transform.bottom_right, transform.anchor) };
+    bool Renderer::polygon_visible(const Transform& transform, const Vertex* verts, const size_t n_verts, const AnchorPoint anchor) {
+        glm::vec2 bounds_min = glm::vec2(verts[0].pos);
+        glm::vec2 bounds_max = glm::vec2(verts[0].pos);
+        for (size_t i = 1; i < n_verts; i++) {
+            bounds_min = glm::min(bounds_min, glm::vec2(verts[i].pos));
+            bounds_max = glm::max(bounds_max, glm::vec2(verts[i].pos));
         }
+        return set_draw_clip(transform.top_left, transform.bottom_right, transform.anchor)
+            && is_visible(apply_anchor_in_pixel_space(bounds_min, anchor), apply_anchor_in_pixel_space(bounds_max, anchor));
+    }
+
+    void Renderer::draw_flat_polygon(Transform transform, Vertex* verts, size_t n_verts, const AnchorPoint anchor) {
+        if (n_verts < 3 || !polygon_visible(transform, verts, n_verts, anchor)) return;
+        const auto pack = [&](const Vertex& v) {
+            return pack_vertex(v.pos, v.pos.z, v.tc, v.color, anchor);
+        };
 
         // Add to render queue
-        for (size_t i = 0; i < n_verts - 2; i++) {
-            m_flat_queue.push_back({ verts[0], verts[i + 2], verts[i + 1] });
+        PackedVertex* out = push_polygon(n_verts, 0);
+        for (size_t i = 0; i < n_verts; i++) {
+            out[i] = pack(verts[i]);
         }
     }
 
-    void Renderer::get_texture(const std::string& texture) {
-        if (!m_textures.contains(texture)) {
-            Texture tex{};
-            if (load_texture(texture, tex))
-                m_textures[texture] = tex;
-            else
-                printf("ERROR: Unable to find texture at path '%s'\n", texture.c_str());
+    const Texture& Renderer::get_texture(const std::string& texture) {
+        std::lock_guard lock(m_texture_mutex);
+        const auto it = m_textures.find(texture);
+        if (it != m_textures.end()) return it->second;
+
+        // Loading uses the backend, which draw list threads can't. They get a placeholder, and end_frame() loads the texture on the main thread
+        if (t_draw_list) {
+            static const Texture placeholder{};
+            if (std::find(m_pending_textures.begin(), m_pending_textures.end(), texture) == m_pending_textures.end()) m_pending_textures.push_back(texture);
+            t_draw_list->used_placeholder = true;
+            return placeholder;
         }
+
+        // Not loaded yet. Failed loads are cached too, so we don't try again every frame
+        Texture tex{};
+        bool loaded = false;
+        run_on_render_thread([&] { loaded = load_texture_to_atlas(texture, tex); });
+        if (!loaded)
+            printf("ERROR: Unable to find texture at path '%s'\n", texture.c_str());
+        return m_textures.emplace(texture, tex).first->second;
     }
 
     void Renderer::draw_polygon_textured(Transform transform, Vertex* verts, size_t n_verts, const std::string& texture, const AnchorPoint anchor) {
         // Upload texture if necessary
-        get_texture(texture);
+        draw_polygon_textured(transform, verts, n_verts, get_texture(texture), anchor);
+    }
 
-        // Scale to screen
-        for (size_t i = 0; i < n_verts; ++i) {
-            verts[i].pos = pixels_to_normalized(verts[i].pos, anchor);
-            verts[i].clip_rect = { apply_anchor_in_pixel_space(transform.top_left, transform.anchor), apply_anchor_in_pixel_space(transform.bottom_right, transform.anchor) };
-        }
+    void Renderer::draw_polygon_textured(const Transform& transform, Vertex* verts, const size_t n_verts, const Texture& texture, const AnchorPoint anchor) {
+        if (n_verts < 3 || !polygon_visible(transform, verts, n_verts, anchor)) return;
+
+        // Scale to screen, and move the texture coordinates to where the texture is in the atlas
+        const auto pack = [&](const Vertex& v) {
+            return pack_vertex(v.pos, v.pos.z, texture.uv_offset + v.tc * texture.uv_scale, v.color, anchor);
+        };
 
         // Add to render queue
-        for (size_t i = 0; i < n_verts - 2; i++) {
-            m_textured_queue[m_textures[texture].id].push_back({verts[0], verts[i + 2], verts[i + 1]});
+        PackedVertex* out = push_polygon(n_verts, texture.id);
+        for (size_t i = 0; i < n_verts; i++) {
+            out[i] = pack(verts[i]);
         }
     }
 
@@ -614,41 +1455,41 @@ namespace Flan {
                 }
             }
         }
+    }
 
-        // Init sine LUT
-        const float inv_sine_lut_size = 6.283185307179f / static_cast<float>(m_sine_lut.size());
-        for (size_t i = 0; i < m_sine_lut.size(); i++) {
-            const float x = static_cast<float>(i) * inv_sine_lut_size;
-            m_sine_lut[i] = sinf(x);
-        }
+    const std::vector<int>& Renderer::glyph_indices(const wchar_t c) const {
+        // Read only, so text can be drawn on any thread. Characters the font doesn't have are skipped
+        static const std::vector<int> none;
+        const auto it = m_wchar_lut.find(c);
+        return it != m_wchar_lut.end() ? it->second : none;
     }
 
     void Renderer::draw_text(Transform transform, const std::wstring& text, glm::vec2 pos, glm::vec2 scale, glm::vec4 color, float depth, AnchorPoint ui_anchor, AnchorPoint text_anchor) {
+        DrawList& list = draw_list();
+        AllocationScope allocation_scope(AllocSubsystem::text);
         init_luts();
         glm::vec2 cur_pos = pos;
 
-        // Calculate width
+        // Calculate width of every line, in scratch memory that's freed at the end of the frame
         float height = static_cast<float>(m_font.grid_h) * scale.y;
-        std::vector<float> widths;
+        const std::span<float> widths = list.arena.alloc_array<float>(std::count(text.begin(), text.end(), L'\n') + 1);
         {
-            float width = 0;
+            size_t line = 0;
             for (auto& c : text) {
                 if (c == '\n') {
-                    widths.push_back(width);
-                    width = 0;
+                    line++;
                     continue;
                 }
 
-                std::vector<int>& wentry = m_wchar_lut[static_cast<wchar_t>(c)];
+                const std::vector<int>& wentry = glyph_indices(static_cast<wchar_t>(c));
                 if (!wentry.empty())
-                    width += static_cast<float>(m_font.widths[wentry[0]]) * scale.x;
+                    widths[line] += static_cast<float>(m_font.widths[wentry[0]]) * scale.x;
             }
-            widths.push_back(width); // the final width doesn't get added in the for loop, do that manually
         }
         height *= static_cast<float>(widths.size());
 
         // Calculate offsets based on text anchor point
-        std::vector<glm::vec3> offsets(widths.size());
+        const std::span<glm::vec3> offsets = list.arena.alloc_array<glm::vec3>(widths.size());
         for (size_t i = 0; i < widths.size(); i++) {
             // Get the offset from the table
             glm::vec3 offset = glm::vec3(anchor_offsets[static_cast<size_t>(text_anchor)], 0);
@@ -670,6 +1511,7 @@ namespace Flan {
             //offsets.push_back({0,0,0});
         }
 
+        list.glyph_scratch.clear();
         int width_idx = 0;
         for (auto& c : text) {
             // Handle newline
@@ -688,64 +1530,149 @@ namespace Flan {
                 continue;
             }
 
-            // Create verts
-            std::vector<int>& wentry = m_wchar_lut[static_cast<wchar_t>(c)];
-
+            // Lay out the glyphs, they're all drawn at once afterwards
+            const std::vector<int>& wentry = glyph_indices(static_cast<wchar_t>(c));
             for (size_t i = 0; i < wentry.size(); i++) {
-                auto wc = wentry[i];
-                glm::vec4 color_noalpha = color * glm::vec4(1, 1, 1, 0);
-                glm::vec3 pos_depth = (glm::vec3(cur_pos, depth) + glm::vec3(0, i * 2, 0)) + offsets[width_idx];
-                glm::vec2 off_uv = glm::vec2(wc % 16, wc >> 4) / glm::vec2(16.f, 8.f);
-                glm::vec2 glyph_size = glm::vec2(1.f / 16.f, 1.f / 8.f);
-                float grid_w_2 = static_cast<float>(m_font.grid_w) * scale.x;
-                float grid_h_2 = static_cast<float>(m_font.grid_h) * scale.y;
-                Vertex v1 = { // top left
-                    pixels_to_normalized(pos_depth + glm::vec3(grid_w_2, 0, 0.0f), ui_anchor),
-                    glm::vec2(1, 0)* glyph_size + off_uv,
-                    color_noalpha,
-                    {transform.top_left, transform.bottom_right}
-                };
-                Vertex v2 = { // top right
-                    pixels_to_normalized(pos_depth + glm::vec3(0, 0, 0.0f), ui_anchor),
-                    glm::vec2(0, 0) * glyph_size + off_uv,
-                    color_noalpha,
-                    {transform.top_left, transform.bottom_right}
-                };
-                Vertex v3 = { // bottom right
-                    pixels_to_normalized(pos_depth + glm::vec3(0, grid_h_2, 0.0f), ui_anchor),
-                    glm::vec2(0, 1) * glyph_size + off_uv,
-                    color_noalpha,
-                    {transform.top_left, transform.bottom_right}
-                };
-                Vertex v4 = { // bottom left
-                    pixels_to_normalized(pos_depth + glm::vec3(grid_w_2, grid_h_2, 0.0f), ui_anchor),
-                    glm::vec2(1, 1) * glyph_size + off_uv,
-                    color_noalpha,
-                    {transform.top_left, transform.bottom_right}
-                };
-
-                // Create triangles and add to queue
-                m_flat_queue.push_back({ v1, v3, v2 });
-                m_flat_queue.push_back({ v1, v4, v3 });
+                const glm::vec2 top_left = cur_pos + glm::vec2(0, i * 2) + glm::vec2(offsets[width_idx]);
+                list.glyph_scratch.push_back({ top_left, static_cast<uint32_t>(wentry[i]) });
             }
 
             // Move cursor
             if (!wentry.empty()) cur_pos.x += static_cast<float>(m_font.widths[wentry[0]]) * scale.x;
         }
+        draw_glyph_run(transform, list.glyph_scratch, scale, color, depth, ui_anchor);
     }
 
-    void Renderer::set_clipping_rectangle(bool enabled, glm::vec2 top_left, glm::vec2 bottom_right)
-    {
-        // If we don't want a clipping rectangle, we just set it to some ridiculously high range, it'll be fine
-        if (enabled == false) {
-            top_left = { -999999.f, -999999.f };
-            bottom_right = { +999999.f, +999999.f };
-            m_clipping_rectangle = { top_left, bottom_right };
+    void Renderer::draw_rects(const Transform& transform, const std::span<const RectCmd> rects, const AnchorPoint anchor) {
+        DrawList& list = draw_list();
+        if (rects.empty() || !set_draw_clip(transform.top_left, transform.bottom_right, transform.anchor)) return;
+        const auto origin = glm::vec2(anchor_origin(anchor));
+        const __m128 origin4 = _mm_setr_ps(origin.x, origin.y, origin.x, origin.y);
+        const __m128 clip = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&list.draw_clip)));
+        size_t n_visible = 0;
+
+        if (m_use_instancing) {
+            Instance* out = push_instances(rects.size(), 0);
+            for (const RectCmd& rect : rects) {
+                const __m128 position = _mm_loadu_ps(&rect.top_left.x);
+                if (!rect_visible_simd(_mm_add_ps(position, origin4), clip)) continue;
+                Instance& instance = out[n_visible++];
+                instance = Instance{ {}, {}, pack_color_simd(rect.color), pack_depth(rect.depth), InstanceKind::rect, 0, 0, {}, static_cast<uint8_t>(anchor), 0 };
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(instance.rect), pack_positions_simd(position));
+            }
+            trim_last_item(n_visible);
+            return;
+        }
+
+        // Same corners as draw_box_solid(): top left, top right, bottom right, bottom left
+        PackedVertex* out = push_quads(rects.size(), 0);
+        for (const RectCmd& rect : rects) {
+            const __m128 position = _mm_loadu_ps(&rect.top_left.x);
+            if (!rect_visible_simd(_mm_add_ps(position, origin4), clip)) continue;
+            alignas(16) int16_t xy[8];
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(xy), pack_positions_simd(position));
+            const uint32_t color = pack_color_simd(rect.color);
+            const int16_t depth = pack_depth(rect.depth);
+            PackedVertex* quad = out + n_visible++ * 4;
+            quad[0] = { xy[0], xy[1], 0, 0, color, depth, static_cast<uint8_t>(anchor), 0 };
+            quad[1] = { xy[2], xy[1], 0, 0, color, depth, static_cast<uint8_t>(anchor), 0 };
+            quad[2] = { xy[2], xy[3], 0, 0, color, depth, static_cast<uint8_t>(anchor), 0 };
+            quad[3] = { xy[0], xy[3], 0, 0, color, depth, static_cast<uint8_t>(anchor), 0 };
+        }
+        trim_last_item(n_visible);
+    }
+
+    void Renderer::draw_lines(const Transform& transform, const std::span<const LineCmd> lines, const AnchorPoint anchor) {
+        DrawList& list = draw_list();
+        if (lines.empty() || !set_draw_clip(transform.top_left, transform.bottom_right, transform.anchor)) return;
+        const auto origin = glm::vec2(anchor_origin(anchor));
+        const __m128 origin4 = _mm_setr_ps(origin.x, origin.y, origin.x, origin.y);
+        const __m128 clip = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&list.draw_clip)));
+        size_t n_visible = 0;
+
+        // Lines reach past their end points by their width, and antialiasing adds another pixel
+        const auto visible = [&](const __m128 points, const float width) {
+            const float margin = width + 1.0f;
+            const __m128 bounds = _mm_add_ps(points_bounds_simd(_mm_add_ps(points, origin4)), _mm_setr_ps(-margin, -margin, margin, margin));
+            return rect_visible_simd(bounds, clip);
+        };
+
+        if (m_use_instancing) {
+            Instance* out = push_instances(lines.size(), 0);
+            for (const LineCmd& line : lines) {
+                const __m128 points = _mm_loadu_ps(&line.a.x);
+                if (!visible(points, line.width)) continue;
+                Instance& instance = out[n_visible++];
+                instance = Instance{ {}, {}, pack_color_simd(line.color), pack_depth(line.depth), InstanceKind::line, 0, static_cast<uint16_t>(pack_position(glm::max(line.width, 0.0f))), {}, static_cast<uint8_t>(anchor), 0 };
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(instance.rect), pack_positions_simd(points));
+            }
+            trim_last_item(n_visible);
             return;
         }
 
-        // Otherwise yeah let's update the variable
-        m_clipping_rectangle = { top_left, bottom_right };
+        // Same corners as draw_line(): a - normal, b - normal, b + normal, a + normal
+        PackedVertex* out = push_quads(lines.size(), 0);
+        for (const LineCmd& line : lines) {
+            const __m128 points = _mm_loadu_ps(&line.a.x);
+            const glm::vec2 direction = line.b - line.a;
+            const float length = glm::length(direction);
+            if (length <= 0.0f || !visible(points, line.width)) continue;
+            const glm::vec2 normal = glm::vec2(-direction.y, direction.x) * (line.width / length);
+            const __m128 normal4 = _mm_setr_ps(normal.x, normal.y, normal.x, normal.y);
+            const __m128 reversed = _mm_shuffle_ps(points, points, _MM_SHUFFLE(1, 0, 3, 2));
+            alignas(16) int16_t xy[8];
+            _mm_store_si128(reinterpret_cast<__m128i*>(xy), pack_positions_simd(_mm_sub_ps(points, normal4), _mm_add_ps(reversed, normal4)));
+            const uint32_t color = pack_color_simd(line.color);
+            const int16_t depth = pack_depth(line.depth);
+            PackedVertex* quad = out + n_visible++ * 4;
+            for (int i = 0; i < 4; ++i) {
+                quad[i] = { xy[i * 2], xy[i * 2 + 1], 0, 0, color, depth, static_cast<uint8_t>(anchor), 0 };
+            }
+        }
+        trim_last_item(n_visible);
+    }
+
+    void Renderer::draw_glyph_run(const Transform& transform, const std::span<const GlyphCmd> glyphs, const glm::vec2 scale, const glm::vec4 color, const float depth, const AnchorPoint anchor) {
+        DrawList& list = draw_list();
+        if (glyphs.empty() || !set_draw_clip(transform.top_left, transform.bottom_right, transform.anchor)) return;
+        const auto origin = glm::vec2(anchor_origin(anchor));
+        const __m128 origin4 = _mm_setr_ps(origin.x, origin.y, origin.x, origin.y);
+        const __m128 clip = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&list.draw_clip)));
+        const glm::vec2 size = glm::vec2(m_font.grid_w, m_font.grid_h) * scale;
+        const __m128 size4 = _mm_setr_ps(0.0f, 0.0f, size.x, size.y);
+        const uint32_t packed_color = pack_color_simd(color * glm::vec4(1, 1, 1, 0)); // Zero alpha means the texture's alpha is used
+        const int16_t packed_depth = pack_depth(depth);
+        size_t n_visible = 0;
+
+        if (m_use_instancing) {
+            Instance* out = push_instances(glyphs.size(), m_font.texture_id);
+            for (const GlyphCmd& glyph : glyphs) {
+                const __m128 rect = _mm_add_ps(_mm_setr_ps(glyph.top_left.x, glyph.top_left.y, glyph.top_left.x, glyph.top_left.y), size4);
+                if (glyph.glyph >= m_font.glyph_uvs.size() || !rect_visible_simd(_mm_add_ps(rect, origin4), clip)) continue;
+                const std::array<uint16_t, 4>& uv = m_font.glyph_uvs[glyph.glyph];
+                Instance& instance = out[n_visible++];
+                instance = Instance{ {}, { uv[0], uv[1], uv[2], uv[3] }, packed_color, packed_depth, InstanceKind::rect, 0, 0, {}, static_cast<uint8_t>(anchor), 0 };
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(instance.rect), pack_positions_simd(rect));
+            }
+            trim_last_item(n_visible);
+            return;
+        }
+
+        // Corners: top right, top left, bottom left, bottom right
+        PackedVertex* out = push_quads(glyphs.size(), m_font.texture_id);
+        for (const GlyphCmd& glyph : glyphs) {
+            const __m128 rect = _mm_add_ps(_mm_setr_ps(glyph.top_left.x, glyph.top_left.y, glyph.top_left.x, glyph.top_left.y), size4);
+            if (glyph.glyph >= m_font.glyph_uvs.size() || !rect_visible_simd(_mm_add_ps(rect, origin4), clip)) continue;
+            const std::array<uint16_t, 4>& uv = m_font.glyph_uvs[glyph.glyph];
+            alignas(16) int16_t xy[8];
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(xy), pack_positions_simd(rect));
+            PackedVertex* quad = out + n_visible++ * 4;
+            quad[0] = { xy[2], xy[1], uv[2], uv[1], packed_color, packed_depth, static_cast<uint8_t>(anchor), 0 };
+            quad[1] = { xy[0], xy[1], uv[0], uv[1], packed_color, packed_depth, static_cast<uint8_t>(anchor), 0 };
+            quad[2] = { xy[0], xy[3], uv[0], uv[3], packed_color, packed_depth, static_cast<uint8_t>(anchor), 0 };
+            quad[3] = { xy[2], xy[3], uv[2], uv[3], packed_color, packed_depth, static_cast<uint8_t>(anchor), 0 };
+        }
+        trim_last_item(n_visible);
     }
 
     glm::vec2 Renderer::apply_anchor(const glm::vec2 pos, AnchorPoint anchor) const {
@@ -764,32 +1691,32 @@ namespace Flan {
 
     glm::vec2 Renderer::apply_anchor_in_pixel_space(glm::vec2 pos, AnchorPoint anchor) const
     {
-        const glm::vec2 pixel_anchor_offsets[] = {
-            {0.5f, 0.5f},
-            {0.0f, 0.0f},
-            {0.5f, 0.0f},
-            {1.0f, 0.0f},
-            {1.0f, 0.5f},
-            {1.0f, 1.0f},
-            {0.5f, 1.0f},
-            {0.0f, 1.0f},
-            {0.0f, 0.5f},
-        };
-        return pos + (pixel_anchor_offsets[static_cast<size_t>(anchor)] * glm::vec2(m_res));
+        return pos + glm::vec2(anchor_origin(anchor));
     }
 
-    bool Renderer::load_texture(const std::string& path, Texture& handle) const {
+    glm::ivec2 Renderer::anchor_origin(const AnchorPoint anchor) const {
+        // Rounded down to whole pixels like in the vertex shaders, so moving a rounded rectangle to another anchor keeps it rounded the same way
+        return glm::ivec2(glm::floor(pixel_anchor_offsets[static_cast<size_t>(anchor)] * glm::vec2(m_res)));
+    }
+
+    uint8_t* load_image(const std::string& path, int& w, int& h, const ModuleHandle module) {
         // Load image
-        int w, h, c;
+        int c;
         uint8_t* data = stbi_load(path.c_str(), &w, &h, &c, 4);
 
         // If not on disk, find in resources
         if (!data) {
-            int size;
-            char* data_resource;
-            read_resource(path, size, data_resource, L"PNG", m_dll);
-            data = stbi_load_from_memory(reinterpret_cast<stbi_uc*>(data_resource), size, &w, &h, &c, 4);
+            std::vector<char> resource;
+            if (!read_resource(path, ResourceType::png, module, resource)) return nullptr;
+            data = stbi_load_from_memory(reinterpret_cast<stbi_uc*>(resource.data()), static_cast<int>(resource.size()), &w, &h, &c, 4);
         }
+        return data;
+    }
+
+    bool Renderer::load_texture(const std::string& path, Texture& handle) const {
+        // Load image
+        int w = 0, h = 0;
+        uint8_t* data = load_image(path, w, h, m_module);
 
         // Did it load correctly?
         if (!data || !w || !h) {
@@ -798,15 +1725,7 @@ namespace Flan {
         }
 
         // Upload texture to GPU
-        glGenTextures(1, &handle.id);
-        glBindTexture(GL_TEXTURE_2D, handle.id);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        handle.id = m_backend->create_texture({ w, h }, data, true);
 
         // Set type
         handle.res = { w, h };
@@ -816,18 +1735,32 @@ namespace Flan {
         return true;
     }
 
-    bool Renderer::load_font(const std::string& path) {
+    bool Renderer::load_texture_to_atlas(const std::string& path, Texture& handle) {
         // Load image
-        int w, h, c;
-        uint8_t* data = stbi_load(path.c_str(), &w, &h, &c, 4);
+        int w = 0, h = 0;
+        uint8_t* data = load_image(path, w, h, m_module);
 
-        // If failed from disk, try from resources
-        if (!data) {
-            int size;
-            char* data_resource;
-            read_resource(path, size, data_resource, L"PNG", m_dll);
-            data = stbi_load_from_memory(reinterpret_cast<stbi_uc*>(data_resource), size, &w, &h, &c, 4);
+        // Did it load correctly?
+        if (!data || !w || !h) {
+            printf("ERROR: Failed to load texture '%s'! STBI returned the following error: %s", path.c_str(), stbi_failure_reason());
+            return false;
         }
+
+        // Pack it into the atlas. If it's too big for an atlas page, it gets its own texture instead
+        AtlasRegion region{};
+        if (m_atlas.add(data, { w, h }, region)) {
+            handle = Texture{ region.texture, { w, h }, region.uv_offset, region.uv_scale };
+            STBI_FREE(data);
+            return true;
+        }
+        STBI_FREE(data);
+        return load_texture(path, handle);
+    }
+
+    bool Renderer::load_font(const std::string& path) {
+        // Load image
+        int w = 0, h = 0;
+        uint8_t* data = load_image(path, w, h, m_module);
         
         // If we still don't have an image, throw an error
         if (!data) {
@@ -877,28 +1810,36 @@ namespace Flan {
             }
         }
 
-        // Upload font texture to GPU
-        GLuint texture_gpu;
-        glGenTextures(1, &texture_gpu);
-        glBindTexture(GL_TEXTURE_2D, texture_gpu);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        // Pack the font into the atlas, so text can be drawn in the same batch as everything else
+        AtlasRegion region{};
+        if (!m_atlas.add(data, { w, h }, region)) {
+            printf("ERROR: Font atlas is too big to fit in a texture atlas page.");
+            STBI_FREE(data);
+            return false;
+        }
+        STBI_FREE(data);
 
         // Create font object
         std::vector<int> widths_vector(128);
-        memcpy_s(widths_vector.data(), widths_vector.size() * 4, widths, 128ull * 4ull);
+        memcpy(widths_vector.data(), widths, 128ull * 4ull);
         m_font = Font {
-            texture_gpu,
+            region.texture,
             static_cast<uint16_t>(glyph_size.x),
             static_cast<uint16_t>(glyph_size.y),
-            widths_vector
+            widths_vector,
+            region.uv_offset,
+            region.uv_scale
         };
 
+        // The glyphs are in a 16x8 grid
+        const glm::vec2 glyph_uv_size = glm::vec2(1.f / 16.f, 1.f / 8.f) * region.uv_scale;
+        m_font.glyph_uvs.resize(128);
+        for (int i = 0; i < 128; i++) {
+            const glm::vec2 top_left = region.uv_offset + glm::vec2(i % 16, i >> 4) / glm::vec2(16.f, 8.f) * region.uv_scale;
+            const glm::vec2 bottom_right = top_left + glyph_uv_size;
+            m_font.glyph_uvs[i] = { pack_unorm16(top_left.x), pack_unorm16(top_left.y), pack_unorm16(bottom_right.x), pack_unorm16(bottom_right.y) };
+        }
+
         return true;
     }
 
@@ -964,11 +1905,8 @@ namespace Flan {
         };
 
         // Read shader source file
-        int shader_size = 0;
-        char* shader_data = nullptr;
-        read_file(path, shader_size, shader_data);
-
-        if (shader_data == nullptr) {
+        std::vector<char> shader_source;
+        if (!read_file(path, shader_source)) {
             return false;
         }
         
@@ -977,7 +1915,8 @@ namespace Flan {
         const GLuint shader = glCreateShader(type_to_create);
 
         // Compile shader source
-        const char* data = shader_data;
+        const char* data = shader_source.data();
+        const auto shader_size = static_cast<GLint>(shader_source.size());
         glShaderSource(shader, 1, &data, &shader_size);
         glCompileShader(shader);
 
@@ -1010,11 +1949,8 @@ namespace Flan {
         };
 
         // Read shader source file
-        int shader_size = 0;
-        char* shader_data = nullptr;
-        read_resource(name, shader_size, shader_data, L"ShaderSource", m_dll);
-
-        if (shader_data == nullptr) {
+        std::vector<char> shader_source;
+        if (!read_resource(name, ResourceType::shader_source, m_module, shader_source)) {
             return false;
         }
 
@@ -1023,7 +1959,8 @@ namespace Flan {
         const GLuint shader = glCreateShader(type_to_create);
 
         // Compile shader source
-        const char* data = shader_data;
+        const char* data = shader_source.data();
+        const auto shader_size = static_cast<GLint>(shader_source.size());
         glShaderSource(shader, 1, &data, &shader_size);
         glCompileShader(shader);
 
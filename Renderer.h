@@ -1,36 +1,109 @@
 #pragma once
 #include <array>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <string>
+#include <thread>
 #include <vector>
 #include <fstream>
 
 #include "GL/glcorearb.h"
 #include "glfw/glfw3.h"
+#ifdef _WIN32
 #define GLFW_EXPOSE_NATIVE_WIN32
 #define GLFW_EXPOSE_NATIVE_WGL
 #define GLFW_NATIVE_INCLUDE_NONE
 #include <glfw/glfw3native.h>
+#endif
 #include "glm/vec2.hpp"
 #include "glm/vec3.hpp"
 #include "glm/vec4.hpp"
 #include "CommonStructs.h"
 #include "RendererStructs.h"
+#include "DamageTracker.h"
+#include "DrawList.h"
+#include "FrameArena.h"
+#include "FrameCommands.h"
+#include "GeometryCache.h"
+#include "Platform.h"
+#include "RenderBackend.h"
+#include "TextureAtlas.h"
 
 namespace Flan {
     class Renderer {
     public:
         //---General---
         void init(bool invisible = false);
-        void init(int w, int h, bool invisible = false, HMODULE dll_handle = nullptr);
+        void init(int w, int h, bool invisible = false, ModuleHandle module = nullptr); // The module images and shaders are looked up in, see Platform.h
         void init(GLFWwindow* window); // Init the renderer using an existing window
+        void init_headless(std::unique_ptr<RenderBackend> backend, glm::ivec2 resolution); // Without a window or GL context, frames go to the backend instead. For benchmarks and tests
+        ~Renderer();
         void begin_frame();
         static void gl_error();
-        void end_frame() const;
+        void end_frame();
         void init_luts();
         void flip_buffers() const;
         [[nodiscard]] GLFWwindow* window() const { return m_window; }
         [[nodiscard]] glm::ivec2 resolution() const { return m_res; }
+        [[nodiscard]] const RenderStats& stats() const { return m_stats; }
+        [[nodiscard]] RenderBackend& backend() const { return *m_backend; }
+        void set_instancing(const bool enabled) { m_use_instancing = enabled; } // Draw simple primitives as instances instead of vertices
+        void invalidate() { m_damage.invalidate(); } // Redraw the whole window next frame, for changes the renderer can't see, like new texture contents
+        [[nodiscard]] FrameArena& frame_arena() { return draw_list().arena; } // Scratch memory for the renderer and the systems on the calling thread, freed when its draw list is reset
+
+        //---Draw Lists---
+        // Systems can generate geometry on other threads. A thread calls begin_draw_list() before drawing and end_draw_list() when it's done, and everything in between
+        // goes into that thread's own list. end_frame() appends the lists to the main thread's geometry sorted by order, so giving every list its own order makes the frame
+        // the same no matter which thread finishes first. Every list has to be ended before end_frame(), and layers can only be recorded on the main thread.
+        // Textures can't be loaded on these threads either. Drawing one that isn't loaded yet draws a placeholder, and the texture is loaded at the end of the frame,
+        // so preload textures with get_texture() on the main thread to have them from the first frame
+        void begin_draw_list(uint32_t order);
+        void end_draw_list();
+
+        //---Render Thread---
+        // With a render thread, end_frame() hands the frame over as a command list, and the render thread draws and presents it while the next one is generated.
+        // The render thread owns the backend from then on, so anything else that uses it has to go through run_on_render_thread(). stats() lag a frame behind
+        void set_render_thread(bool enabled);
+        void run_on_render_thread(const std::function<void()>& task); // Runs the task on whichever thread owns the backend, and waits for it
+
+        //---Frame Pacing---
+        // In on-demand mode begin_frame() sleeps until there's input, a requested frame is due, or another thread calls wake()
+        void set_frame_mode(const FrameMode mode) { m_frame_mode = mode; }
+        void request_frame() { m_frame_requested = true; } // Draw the next frame right away, for example while something is animating
+        void request_frame_at(double time); // Draw a frame at the given glfwGetTime(), for animation deadlines
+        // Can be called from any thread, for work that finishes outside the frame, like a file that was loaded in the background.
+        // Values are different: the pool isn't thread safe, so they're only changed on the main thread, and update_entities() requests the frame for them
+        static void wake() { glfwPostEmptyEvent(); }
+
+        //---Retained Geometry---
+        // Everything drawn between begin_cache() and end_cache() is stored in a cache entry on the GPU, and drawn again with draw_cached() without regenerating it.
+        // Handles start out as INVALID_CACHE_HANDLE, end_cache() creates the entry. draw_cached() returns false if the entry has to be regenerated.
+        // The contents aren't culled by the window or the clip stack while recording, so entries stay valid when the window is resized or they're drawn in another clip rectangle
+        #define INVALID_CACHE_HANDLE UINT32_MAX
+        void begin_cache();
+        void end_cache(uint32_t& handle);
+        bool draw_cached(uint32_t handle);
+        void release_cache(uint32_t& handle);
+
+        //---Scrolling---
+        // Content drawn between begin_scroll_content() and end_scroll_content() is stored in a cache entry without being drawn. Like any cache entry it isn't culled,
+        // so it's complete even where it's scrolled out of view. draw_scrolled() then draws it moved by an offset in pixels and clipped to the top of the clip stack, without regenerating it
+        void begin_scroll_content();
+        void end_scroll_content(uint32_t& handle);
+        bool draw_scrolled(uint32_t handle, glm::vec2 offset);
+
+        //---Layers---
+        // Everything drawn between begin_layer() and end_layer() is rendered into an offscreen texture, which draw_layer() then draws as a single quad.
+        // Handles work like cache handles, draw_layer() returns false if the layer has to be rendered again. Layers can't be nested or recorded into a cache entry.
+        void begin_layer(glm::vec2 top_left, glm::vec2 bottom_right, float depth = 0.0f, AnchorPoint anchor = AnchorPoint::top_left);
+        void end_layer(uint32_t& handle);
+        bool draw_layer(uint32_t handle);
+        void release_layer(uint32_t& handle);
 
         //---Resource Management---
         static GLuint shader_from_file(const std::string& path);
@@ -40,6 +113,7 @@ namespace Flan {
         [[nodiscard]] bool shader_part_from_resource(const std::string& name, ShaderType type, const GLuint& program) const;
         static bool shader_part_from_string(const std::string& string, ShaderType type, const GLuint& program);
         bool load_texture(const std::string& path, Texture& handle) const;
+        bool load_texture_to_atlas(const std::string& path, Texture& handle);
         bool load_font(const std::string& path);
 
         //---Drawing Functions---
@@ -50,31 +124,130 @@ namespace Flan {
         void draw_polygon_textured(Transform transform, Vertex* verts, size_t n_verts, const std::string& texture, AnchorPoint anchor = AnchorPoint::top_left);
         void draw_circle_line(Transform transform, glm::vec2 center, glm::vec2 scale, glm::vec4 color, float width = 1.0f, float depth = 0.0f, AnchorPoint anchor = AnchorPoint::top_left);
         void draw_circle_solid(Transform transform, glm::vec2 center, glm::vec2 scale, glm::vec4 color, float depth = 0.0f, AnchorPoint anchor = AnchorPoint::top_left);
+        void draw_rounded_box_solid(Transform transform, glm::vec2 top_left, glm::vec2 bottom_right, float radius, glm::vec4 color, float depth = 0.0f, AnchorPoint anchor = AnchorPoint::top_left);
+        void draw_rounded_box_line(Transform transform, glm::vec2 top_left, glm::vec2 bottom_right, float radius, glm::vec4 color, float width = 1.0f, float depth = 0.0f, AnchorPoint anchor = AnchorPoint::top_left);
+        void draw_capsule(Transform transform, glm::vec2 a, glm::vec2 b, glm::vec4 color, float radius = 1.0f, float depth = 0.0f, AnchorPoint anchor = AnchorPoint::top_left);
+        void draw_polyline(Transform transform, const glm::vec2* points, size_t n_points, glm::vec4 color, float width = 1.0f, float depth = 0.0f, bool closed = false, LineJoin join = LineJoin::miter, AnchorPoint anchor = AnchorPoint::top_left);
         void draw_flat_polygon(Transform transform, Vertex* verts, size_t n_verts, AnchorPoint anchor);
-        void get_texture(const std::string& texture);
+        const Texture& get_texture(const std::string& texture);
         void draw_text(Transform transform, const std::wstring& text, glm::vec2 pos, glm::vec2 scale, glm::vec4 color, float depth, AnchorPoint ui_anchor = AnchorPoint::top_left, AnchorPoint text_anchor = AnchorPoint::top_left);
-        void set_clipping_rectangle(bool enabled, glm::vec2 top_left = {0.0f, 0.0f}, glm::vec2 bottom_right = {0.0f, 0.0f});
+
+        //---Bulk Drawing---
+        // Many primitives with the same transform and anchor point at once. They're culled and packed straight into the frame's arrays in one loop, as a single draw item
+        void draw_rects(const Transform& transform, std::span<const RectCmd> rects, AnchorPoint anchor = AnchorPoint::top_left);
+        void draw_lines(const Transform& transform, std::span<const LineCmd> lines, AnchorPoint anchor = AnchorPoint::top_left);
+        void draw_glyph_run(const Transform& transform, std::span<const GlyphCmd> glyphs, glm::vec2 scale, glm::vec4 color, float depth, AnchorPoint anchor = AnchorPoint::top_left);
+        void push_clip_rect(glm::vec2 top_left, glm::vec2 bottom_right, AnchorPoint anchor = AnchorPoint::top_left); // Clips everything drawn until the matching pop, intersected with the rectangles below it
+        void pop_clip_rect();
         [[nodiscard]] glm::vec2 apply_anchor(glm::vec2 pos, AnchorPoint anchor) const;
         [[nodiscard]] glm::vec2 pixels_to_normalized(glm::vec2 pos, AnchorPoint anchor = AnchorPoint::top_left) const;
         [[nodiscard]] glm::vec3 pixels_to_normalized(glm::vec3 pos, AnchorPoint anchor = AnchorPoint::top_left) const;
         [[nodiscard]] glm::vec2 apply_anchor_in_pixel_space(glm::vec2 pos, AnchorPoint anchor = AnchorPoint::top_left) const;
+        [[nodiscard]] glm::ivec2 anchor_origin(AnchorPoint anchor) const; // Position of the anchor point in the window, in whole pixels
         [[nodiscard]] float get_font_height() const { return m_font.grid_h; }
+        [[nodiscard]] static int circle_segments(float radius);
+        const std::vector<glm::vec2>& unit_circle(int n_segments);
     private:
+        void push_item(BatchType type, GLuint texture, size_t first_vertex, size_t n_verts, size_t first_index, size_t n_indices);
+        PackedVertex* push_quads(size_t n_quads, GLuint texture);
+        PackedVertex* push_indexed(size_t n_verts, size_t n_indices, GLuint texture, uint16_t*& indices);
+        PackedVertex* push_polygon(size_t n_verts, GLuint texture);
+        Instance* push_instances(size_t n_instances, GLuint texture);
+        void trim_last_item(size_t n_used);
+        void tessellate_stroke(size_t first_segment, size_t end_segment, bool closed, float width, LineJoin join);
+        void push_clip_index(const glm::ivec4& clip);
+        void init_resources();
+        void store_cache(uint32_t& handle);
+        void item_footprint(const DrawList& list, DrawItem& item) const;
+        [[nodiscard]] glm::ivec4 track_damage();
+        [[nodiscard]] DrawList& draw_list(); // The calling thread's list
+        [[nodiscard]] const DrawList& draw_list() const;
+        void merge_draw_lists();
+        void load_pending_textures();
+        [[nodiscard]] const std::vector<int>& glyph_indices(wchar_t c) const;
+        uint64_t post_to_render_thread(std::function<void()> task);
+        void wait_for_render_thread(uint64_t ticket);
+        void render_thread_main();
+        void wait_for_frame();
+        bool set_draw_clip(glm::vec2 top_left, glm::vec2 bottom_right, AnchorPoint anchor = AnchorPoint::top_left);
+        [[nodiscard]] bool is_visible(glm::vec2 top_left, glm::vec2 bottom_right) const;
+        bool polygon_visible(const Transform& transform, const Vertex* verts, size_t n_verts, AnchorPoint anchor);
+        void draw_polygon_textured(const Transform& transform, Vertex* verts, size_t n_verts, const Texture& texture, AnchorPoint anchor);
+
+        #define CACHE_CLIP_EXTENT 8192.0f // Clip rectangle while recording a cache entry, as far as packed positions reach
+
+        // The draw functions write into the calling thread's list. The other threads' lists are merged into the main thread's, and end_frame() moves that into a command list
+        DrawList m_draw_list;
+        std::vector<std::unique_ptr<DrawList>> m_worker_lists; // Kept across frames, so their memory is reused
+        size_t m_n_worker_lists = 0;                            // Handed out this frame
+        std::mutex m_draw_list_mutex;
+
+        // Retained geometry, kept across frames
+        CacheBuffer m_cached_vertices;
+        CacheBuffer m_cached_indices;
+        CacheBuffer m_cached_instances;
+        std::vector<CacheEntry> m_cache_entries;
+        std::vector<uint32_t> m_free_cache_entries;
+        size_t m_cache_bytes_uploaded = 0;
+        std::vector<uint32_t> m_placeholder_entries; // Stored with placeholder textures, regenerated once the textures are loaded
+        std::mutex m_cache_mutex; // Entries can be stored and drawn on any thread
+
+        // Layers, kept across frames
+        std::vector<LayerEntry> m_layers;
+        std::vector<uint32_t> m_free_layers;
+        std::vector<DrawItem> m_layer_items; // Items of every layer ended this frame, their geometry stays in the frame's arrays
+        std::vector<LayerPass> m_layer_passes;
+        ArraySizes m_layer_start{};          // Array sizes at begin_layer()
+        glm::ivec4 m_layer_rect{};
+        glm::vec4 m_layer_parent_clip{};
+        float m_layer_depth = 0.0f;
+        bool m_recording_layer = false;
+
+        // The backend keeps the last frame, so only the damaged part has to be redrawn
+        DamageTracker m_damage;
+        glm::ivec2 m_damage_res{}; // Resolution the damage tracker last saw, a resize redraws everything
+        double m_frame_interval = 1.0 / 60.0; // Seconds between vsyncs, how long a skipped frame waits
+
+        // Input is sampled at the end of the frame, and the systems draw before they handle it, so it takes a few frames for an event to show up
+        #define FRAMES_AFTER_WAKE 3
+        FrameMode m_frame_mode = FrameMode::continuous;
+        bool m_frame_requested = false;
+        double m_frame_deadline = INFINITY;
+        int m_frames_after_wake = 0;
+        RenderStats m_stats;       // Of the last finished frame
+        RenderStats m_frame_stats; // Of the frame that's being generated
+
+        // Two command lists, so the main thread can fill one while the render thread submits the other
+        FrameCommands m_frame_commands[2];
+        uint64_t m_frame_tickets[2]{}; // Render thread task that submits each of them
+        size_t m_recording = 0;        // The one end_frame() fills next
 
-        std::vector<Triangle> m_flat_queue;
-        std::map<GLuint, std::vector<Triangle>> m_textured_queue;
-        GLFWwindow* m_window = nullptr;
+        // The render thread runs tasks in the order they were posted. Frames are tasks too, so a task posted after end_frame() runs after that frame is submitted
+        std::thread m_render_thread;
+        std::mutex m_render_mutex;
+        std::condition_variable m_render_cv;
+        std::vector<std::function<void()>> m_render_tasks;  // Posted, not picked up yet
+        std::vector<std::function<void()>> m_running_tasks; // Render thread only
+        uint64_t m_tasks_posted = 0;
+        uint64_t m_tasks_done = 0;
+        bool m_render_thread_quit = false;
+        RenderStats m_submitted_stats; // Of the last frame the render thread finished
+        std::unique_ptr<RenderBackend> m_backend;
+        GLFWwindow* m_window = nullptr; // Null when headless
         const glm::ivec2 m_res_ref = { 1280, 720 };
         glm::ivec2 m_res = m_res_ref;
-        GLuint m_shader{};
-        GLuint m_vao{};
-        GLuint m_vbo{};
+        bool m_use_instancing = true;
         Font m_font{};
-        ClipRect m_clipping_rectangle{};
-        #define SINE_LUT_RESOLUTION 32
-        std::array<float, SINE_LUT_RESOLUTION> m_sine_lut{};
+        std::map<int, std::vector<glm::vec2>> m_unit_circles; // Cached per segment count
+        std::mutex m_unit_circle_mutex;
+        #define POLYLINE_RUN_SEGMENTS 1024 // Polylines are split into runs this long, so each run fits in 16-bit indices
+        #define MITER_LIMIT 4.0f
         std::map<wchar_t, std::vector<int>> m_wchar_lut;
+        #define ATLAS_PAGE_SIZE 2048
+        TextureAtlas m_atlas;
         std::map<std::string, Texture> m_textures;
-        HMODULE m_dll{};
+        std::vector<std::string> m_pending_textures; // Asked for on draw list threads, loaded in end_frame()
+        std::mutex m_texture_mutex;
+        ModuleHandle m_module{};
     };
 }
@@ -1,31 +1,138 @@
 #pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
 #include "GL/glcorearb.h"
+#include "glm/common.hpp"
 #include "glm/vec2.hpp"
 #include "glm/vec3.hpp"
 #include "glm/vec4.hpp"
+#include "CommonStructs.h"
 
 namespace Flan {
     struct Vertex {
         glm::vec3 pos{};
         glm::vec2 tc{};
         glm::vec4 color{};
-        glm::vec4 clip_rect = { -99999, -99999, 99999, 99999 };
     };
 
-    struct Triangle {
-        Vertex a;
-        Vertex b;
-        Vertex c;
+    // Sub-pixel precision of packed vertex positions
+    #define VERTEX_POSITION_SCALE 4.0f
+
+    // The vertex format that is sent to the GPU. Positions are in pixels relative to the anchor point, the vertex shader adds the anchor's position in the window.
+    // That way the geometry doesn't depend on the window size
+    struct PackedVertex {
+        int16_t x, y;     // Pixels * VERTEX_POSITION_SCALE
+        uint16_t u, v;    // unorm16
+        uint32_t color;   // RGBA8
+        int16_t depth;    // snorm16
+        uint8_t anchor;   // AnchorPoint
+        uint8_t padding;  // Keeps vertices 16 bytes
+    };
+    static_assert(sizeof(PackedVertex) == 16);
+
+    // Quantization helpers for the packed formats
+    inline int16_t pack_position(const float pixels) {
+        return static_cast<int16_t>(glm::clamp(glm::round(pixels * VERTEX_POSITION_SCALE), static_cast<float>(INT16_MIN), static_cast<float>(INT16_MAX)));
+    }
+    inline uint16_t pack_unorm16(const float value) {
+        return static_cast<uint16_t>(glm::round(glm::clamp(value, 0.0f, 1.0f) * 65535.0f));
+    }
+    inline int16_t pack_depth(const float depth) {
+        return static_cast<int16_t>(glm::round(glm::clamp(depth, -1.0f, 1.0f) * 32767.0f));
+    }
+    inline uint32_t pack_color(const glm::vec4 color) {
+        const glm::vec4 color_fixed = glm::round(glm::clamp(color, 0.0f, 1.0f) * 255.0f);
+        return static_cast<uint32_t>(color_fixed.r) | static_cast<uint32_t>(color_fixed.g) << 8 | static_cast<uint32_t>(color_fixed.b) << 16 | static_cast<uint32_t>(color_fixed.a) << 24;
+    }
+
+    inline PackedVertex pack_vertex(const glm::vec2 pos, const float depth, const glm::vec2 tc, const glm::vec4 color, const AnchorPoint anchor) {
+        return PackedVertex{
+            pack_position(pos.x),
+            pack_position(pos.y),
+            pack_unorm16(tc.x),
+            pack_unorm16(tc.y),
+            pack_color(color),
+            pack_depth(depth),
+            static_cast<uint8_t>(anchor),
+            0,
+        };
+    }
+
+    // What instance.vert expands an instance into
+    enum class InstanceKind : uint8_t {
+        rect,              // Solid or textured rectangle
+        line,              // Line from (x0, y0) to (x1, y1), extruded by width on both sides
+        ellipse,           // Filled ellipse inside the rectangle
+        ellipse_line,      // Outline of the ellipse inside the rectangle, width thick on both sides of the edge
+        rounded_rect,      // Filled rectangle with rounded corners
+        rounded_rect_line, // Outline of a rectangle with rounded corners, width thick on both sides of the edge
+        capsule,           // Line from (x0, y0) to (x1, y1) with round caps, width is the radius
+        nine_slice,        // Textured rectangle where the borders keep their size and only the middle stretches
+        layer,             // Rectangle showing a layer texture, which already has premultiplied alpha
+    };
+
+    // A whole primitive in a single record, expanded into a quad by instance.vert
+    struct Instance {
+        int16_t rect[4];   // Top left and bottom right, pixels * VERTEX_POSITION_SCALE
+        uint16_t uv[4];    // Texture coordinates at the top left and bottom right, unorm16
+        uint32_t color;    // RGBA8
+        int16_t depth;     // snorm16
+        InstanceKind kind;
+        uint8_t corner_radius; // Pixels
+        uint16_t width;    // Pixels * VERTEX_POSITION_SCALE
+        uint8_t insets[4]; // Nine-slice borders in texels: left, top, right, bottom. They're drawn 1:1 on screen
+        uint8_t anchor;    // AnchorPoint the rectangle is relative to
+        uint8_t padding;
     };
+    static_assert(sizeof(Instance) == 32);
+
+    inline Instance pack_instance(const InstanceKind kind, const glm::vec2 top_left, const glm::vec2 bottom_right, const float depth, const glm::vec2 uv_top_left, const glm::vec2 uv_bottom_right, const glm::vec4 color, const AnchorPoint anchor, const float width = 0.0f, const float corner_radius = 0.0f) {
+        return Instance{
+            { pack_position(top_left.x), pack_position(top_left.y), pack_position(bottom_right.x), pack_position(bottom_right.y) },
+            { pack_unorm16(uv_top_left.x), pack_unorm16(uv_top_left.y), pack_unorm16(uv_bottom_right.x), pack_unorm16(uv_bottom_right.y) },
+            pack_color(color),
+            pack_depth(depth),
+            kind,
+            static_cast<uint8_t>(glm::clamp(glm::round(corner_radius), 0.0f, 255.0f)),
+            static_cast<uint16_t>(pack_position(glm::max(width, 0.0f))),
+            {},
+            static_cast<uint8_t>(anchor),
+            0,
+        };
+    }
 
     struct Font {
         GLuint texture_id;
         uint16_t grid_w;
         uint16_t grid_h;
         std::vector<int> widths;
+        glm::vec2 uv_offset = { 0, 0 }; // Where the font is in its atlas page
+        glm::vec2 uv_scale = { 1, 1 };
+        std::vector<std::array<uint16_t, 4>> glyph_uvs{}; // Texture coordinates of every glyph at the top left and bottom right, unorm16
+    };
+
+    // Primitives for the bulk draw functions. Positions are in pixels relative to the anchor point
+    struct RectCmd {
+        glm::vec2 top_left;
+        glm::vec2 bottom_right; // Right after top_left, so both can be loaded at once
+        glm::vec4 color;
+        float depth;
+    };
+    struct LineCmd {
+        glm::vec2 a;
+        glm::vec2 b;
+        glm::vec4 color;
+        float width;
+        float depth;
+    };
+    struct GlyphCmd {
+        glm::vec2 top_left;
+        uint32_t glyph; // Index in the font's grid
     };
+    static_assert(offsetof(RectCmd, bottom_right) == offsetof(RectCmd, top_left) + sizeof(glm::vec2) && offsetof(LineCmd, b) == offsetof(LineCmd, a) + sizeof(glm::vec2));
 
     enum class ShaderType {
         vertex,
@@ -34,6 +141,13 @@ namespace Flan {
         compute
     };
 
+    // How the segments of a polyline are connected
+    enum class LineJoin {
+        miter,
+        bevel,
+        round
+    };
+
     enum class TextureType {
         stretch,
         tile,
@@ -43,10 +157,74 @@ namespace Flan {
     struct Texture {
         GLuint id;
         glm::ivec2 res;
+        glm::vec2 uv_offset = { 0, 0 }; // Where the texture is in its atlas page. Standalone textures cover the whole range
+        glm::vec2 uv_scale = { 1, 1 };
     };
 
-    struct ClipRect {
-        glm::vec2 top_left;
-        glm::vec2 bottom_right;
+    enum class BatchType : uint8_t {
+        quads,     // Groups of 4 vertices, drawn with the shared quad index buffer
+        indexed,   // Vertices with their own indices in the index stream
+        instances, // Records in the instance stream, each expanded into a quad
+    };
+
+    // The geometry of a single draw function call, in the renderer's CPU-side arrays or in the geometry cache. Texture 0 means it doesn't sample any texture.
+    // For instance items, first_vertex and n_vertices refer to the instance array instead
+    struct DrawItem {
+        BatchType type;
+        bool cached;           // The offsets point into the geometry cache buffers, which are already on the GPU
+        GLuint texture;
+        uint32_t clip;         // Index into the frame's clip rectangles
+        uint32_t first_vertex;
+        uint32_t n_vertices;
+        uint32_t first_index;  // Indexed items only. Indices are relative to first_vertex
+        uint32_t n_indices;
+        uint64_t key;          // Cached items only, the sort key without the clip
+        uint64_t hash;         // Hash of the geometry and texture, for damage tracking
+        glm::ivec4 bounds;     // Pixels covered before clipping relative to the anchor point, for damage tracking
+        glm::vec2 offset;      // Cached items only, moves the geometry on the GPU for scrolled content
+        AnchorPoint anchor;    // What the geometry is relative to
+        AnchorPoint clip_anchor; // What the clip rectangle moves with when the window is resized
+    };
+
+    // Sort key of a draw item, from the most significant bit: layer (opaque or translucent), depth, then pipeline, texture and clip for opaque items. See FrameCommands.h
+    struct SortEntry {
+        uint64_t key;
+        uint32_t item;
+    };
+
+    // A range of vertices in the vertex stream that can be drawn with a single draw call. Texture 0 means the batch doesn't sample any texture yet.
+    // For instance batches, first_vertex and n_vertices refer to the instance stream instead
+    struct DrawBatch {
+        GLuint texture;
+        BatchType type;
+        GLint first_vertex;
+        GLsizei n_vertices;
+        GLsizei first_index; // Indexed batches only. Indices are relative to first_vertex
+        GLsizei n_indices;
+        glm::ivec4 clip;     // Scissor box in window pixels from the top left: x0, y0, x1, y1 (exclusive)
+        bool translucent;    // Blended without writing depth
+        bool cached;         // Drawn from the geometry cache buffers instead of the streams
+        glm::vec2 offset;    // Pixels added to every position in the vertex shader
+    };
+
+    // When the main loop draws frames
+    enum class FrameMode {
+        continuous, // Every vsync
+        on_demand,  // Only after input, wake() or request_frame(), sleeping in between
+    };
+
+    // Statistics of the last rendered frame
+    struct RenderStats {
+        uint32_t n_draw_calls = 0;
+        uint32_t n_vertices = 0;
+        uint32_t n_indices = 0;
+        uint32_t n_instances = 0;
+        size_t n_bytes_uploaded = 0;
+        uint32_t n_scissor_changes = 0;
+        uint32_t n_draw_items = 0;
+        uint32_t n_translucent_items = 0;
+        uint32_t n_cached_items = 0;
+        glm::ivec4 damage{};        // The part of the window that was redrawn, empty if the frame was skipped
+        bool frame_skipped = false; // Nothing changed, so nothing was drawn or presented
     };
 }
@@ -0,0 +1,135 @@
+#include "RendererTests.h"
+
+#ifdef FLAN_TEST
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "Renderer.h"
+
+namespace Flan {
+    namespace {
+        #define TEST_FRAMES 4
+        #define TEST_RESOLUTION glm::ivec2(640, 480)
+
+        int g_failures = 0;
+
+        void check(const bool condition, const char* what) {
+            if (condition) return;
+            printf("FAILED: %s\n", what);
+            g_failures++;
+        }
+
+        // Something of every kind of geometry. The box moves every frame, so every frame has damage and gets submitted
+        void draw_scene(Renderer& renderer, const int frame) {
+            const Transform transform({ 0, 0 }, TEST_RESOLUTION);
+            const float x = 20.0f + static_cast<float>(frame) * 10.0f;
+            renderer.draw_box_solid(transform, { x, 20 }, { x + 100, 80 }, { 1, 0, 0, 1 }, 0.1f);
+            renderer.draw_rounded_box_line(transform, { 20, 100 }, { 220, 160 }, 8.0f, { 0, 1, 0, 0.5f }, 2.0f, 0.2f);
+            renderer.draw_circle_solid(transform, { 320, 240 }, { 40, 40 }, { 0, 0, 1, 1 }, 0.3f);
+            renderer.draw_line(transform, { 0, 0 }, { 640, 480 }, { 1, 1, 1, 1 }, 3.0f, 0.4f);
+            renderer.draw_text(transform, L"Headless", { 20, 200 }, { 2, 2 }, { 1, 1, 1, 1 }, 0.5f);
+
+            const RectCmd rects[] = {
+                { { 400, 20 }, { 440, 60 }, { 1, 1, 0, 1 }, 0.6f },
+                { { 460, 20 }, { 500, 60 }, { 0, 1, 1, 0.5f }, 0.6f },
+            };
+            renderer.draw_rects(transform, rects);
+        }
+
+        // Draws the scene for a few frames and returns everything the backend was sent
+        std::vector<uint8_t> record_scene(RenderStats& last_stats) {
+            auto backend = std::make_unique<RecordingBackend>();
+            const RecordingBackend* recording = backend.get();
+            Renderer renderer;
+            renderer.init_headless(std::move(backend), TEST_RESOLUTION);
+            for (int frame = 0; frame < TEST_FRAMES; ++frame) {
+                renderer.begin_frame();
+                draw_scene(renderer, frame);
+                renderer.end_frame();
+            }
+            last_stats = renderer.stats();
+            return recording->data();
+        }
+
+        struct RecordingSummary {
+            uint32_t n_records[static_cast<size_t>(RenderCommand::submit_frame) + 1]{};
+            uint32_t n_vertices = 0;
+            uint32_t n_instances = 0;
+            bool valid = true; // Every record fits in the recording
+        };
+
+        uint32_t read_u32(const std::vector<uint8_t>& data, const size_t offset) {
+            uint32_t value = 0;
+            memcpy(&value, &data[offset], sizeof(value));
+            return value;
+        }
+
+        // Walks the records, and adds up the geometry of the frames. See RecordingBackend for the layout
+        RecordingSummary summarize(const std::vector<uint8_t>& data) {
+            RecordingSummary summary;
+            size_t offset = 0;
+            while (offset + 8 <= data.size()) {
+                const uint32_t command = read_u32(data, offset);
+                const uint32_t size = read_u32(data, offset + 4);
+                offset += 8;
+                if (command > static_cast<uint32_t>(RenderCommand::submit_frame) || offset + size > data.size()) {
+                    summary.valid = false;
+                    return summary;
+                }
+                summary.n_records[command]++;
+
+                // A frame starts with the resolution and the damage, then the vertex, index and instance arrays, each prefixed with its length
+                if (command == static_cast<uint32_t>(RenderCommand::submit_frame)) {
+                    size_t field = offset + sizeof(glm::ivec2) + sizeof(glm::ivec4);
+                    const uint32_t n_vertices = read_u32(data, field);
+                    field += sizeof(uint32_t) + n_vertices * sizeof(PackedVertex);
+                    const uint32_t n_indices = read_u32(data, field);
+                    field += sizeof(uint32_t) + n_indices * sizeof(uint16_t);
+                    summary.n_vertices += n_vertices;
+                    summary.n_instances += read_u32(data, field);
+                }
+                offset += size;
+            }
+            summary.valid = offset == data.size();
+            return summary;
+        }
+
+        void test_recording_has_geometry() {
+            RenderStats stats;
+            const std::vector<uint8_t> data = record_scene(stats);
+            const RecordingSummary summary = summarize(data);
+            check(!data.empty(), "The recording is not empty");
+            check(summary.valid, "The records add up to the size of the recording");
+            check(summary.n_records[static_cast<size_t>(RenderCommand::submit_frame)] == TEST_FRAMES, "Every frame is submitted");
+            check(summary.n_records[static_cast<size_t>(RenderCommand::create_texture)] > 0, "The font's atlas page is created");
+            check(summary.n_vertices + summary.n_instances > 0, "The frames contain geometry");
+            check(stats.n_draw_items > 0, "The last frame has draw items");
+        }
+
+        void test_recording_is_deterministic() {
+            RenderStats stats;
+            const std::vector<uint8_t> a = record_scene(stats);
+            const std::vector<uint8_t> b = record_scene(stats);
+            check(a.size() == b.size() && memcmp(a.data(), b.data(), a.size()) == 0, "The same frames give the same recording");
+        }
+    }
+
+    int run_renderer_tests() {
+        g_failures = 0;
+
+        // Off Windows the font is read from the working directory, and drawing text without it isn't safe
+        std::vector<char> font;
+        if (!read_resource("font.png", ResourceType::png, nullptr, font)) {
+            printf("FAILED: font.png wasn't found, run the tests from the directory it's in\n");
+            return 1;
+        }
+
+        test_recording_has_geometry();
+        test_recording_is_deterministic();
+        printf("Renderer tests: %s (%i failed)\n", g_failures == 0 ? "passed" : "FAILED", g_failures);
+        return g_failures;
+    }
+}
+#endif
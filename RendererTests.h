@@ -0,0 +1,7 @@
+#pragma once
+
+namespace Flan {
+    // Headless renderer tests, built with FLAN_TEST. They draw through a RecordingBackend, so they need no window, GL context or Win32.
+    // Prints every failed check, and returns the number of failures so it can be the exit code
+    int run_renderer_tests();
+}
@@ -0,0 +1,95 @@
+#version 430 core
+precision mediump float;
+
+out vec4 frag_color;
+in vec2 texcoord;
+in vec4 colour;
+in vec2 local_pos;
+flat in uint kind;
+flat in vec2 half_size;
+flat in float width;
+flat in float corner_radius;
+flat in vec4 insets;
+flat in vec4 uv_rect;
+
+uniform sampler2D tex;
+
+#define KIND_RECT 0
+#define KIND_LINE 1
+#define KIND_ELLIPSE 2
+#define KIND_ELLIPSE_LINE 3
+#define KIND_ROUNDED_RECT 4
+#define KIND_ROUNDED_RECT_LINE 5
+#define KIND_CAPSULE 6
+#define KIND_NINE_SLICE 7
+#define KIND_LAYER 8
+
+// Map a pixel position inside the rectangle to a texel position, keeping the borders at their original size
+float nine_slice_axis(float p, float size, float tex_size, float border_start, float border_end) {
+    if (p < border_start) return p;
+    if (p > size - border_end) return tex_size - (size - p);
+    float middle = max(size - border_start - border_end, 1.0);
+    return border_start + (p - border_start) / middle * (tex_size - border_start - border_end);
+}
+
+// Signed distance to a box centered on the origin, negative inside
+float sd_rounded_box(vec2 p, vec2 size, float r) {
+    r = min(r, min(size.x, size.y));
+    vec2 q = abs(p) - size + r;
+    return length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - r;
+}
+
+// Approximate signed distance to an ellipse centered on the origin, good enough for antialiasing
+float sd_ellipse(vec2 p, vec2 r) {
+    float k0 = length(p / r);
+    float k1 = length(p / (r * r));
+    if (k1 < 1e-5) return -min(r.x, r.y);
+    return k0 * (k0 - 1.0) / k1;
+}
+
+void main()
+{
+    // Output is premultiplied alpha. Plain rectangles are the only ones that can be textured
+    if (kind == KIND_RECT) {
+        if (colour.a != 0.0f)
+            frag_color = vec4(colour.rgb * colour.a, colour.a);
+        else {
+            vec4 texel = texture(tex, texcoord);
+            frag_color = vec4(colour.rgb * texel.rgb * texel.a, texel.a);
+        }
+        return;
+    }
+
+    // Layers were rendered with premultiplied alpha already, the color alpha fades the whole layer
+    if (kind == KIND_LAYER) {
+        frag_color = texture(tex, texcoord) * colour.a;
+        return;
+    }
+
+    if (kind == KIND_NINE_SLICE) {
+        vec2 tex_size = abs(uv_rect.zw - uv_rect.xy) * vec2(textureSize(tex, 0));
+        vec2 size = half_size * 2.0;
+        vec2 p = local_pos + half_size;
+        vec2 texel = vec2(nine_slice_axis(p.x, size.x, tex_size.x, insets.x, insets.z),
+                          nine_slice_axis(p.y, size.y, tex_size.y, insets.y, insets.w));
+        vec2 uv = mix(uv_rect.xy, uv_rect.zw, texel / tex_size);
+        vec4 texel = texture(tex, uv);
+        frag_color = vec4(colour.rgb * texel.rgb * texel.a, texel.a);
+        return;
+    }
+
+    // Everything else is a signed distance in pixels
+    float distance;
+    if (kind == KIND_ELLIPSE || kind == KIND_ELLIPSE_LINE)
+        distance = sd_ellipse(local_pos, half_size);
+    else
+        distance = sd_rounded_box(local_pos, half_size, corner_radius);
+    if (kind == KIND_ELLIPSE_LINE || kind == KIND_ROUNDED_RECT_LINE)
+        distance = abs(distance) - width;
+
+    // Cover half a pixel on either side of the edge
+    float coverage = clamp(0.5 - distance, 0.0, 1.0);
+    if (coverage <= 0.0) discard;
+    float alpha = colour.a * coverage;
+    frag_color = vec4(colour.rgb * alpha, alpha);
+}
\ No newline at end of file
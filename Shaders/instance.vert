@@ -0,0 +1,93 @@
+#version 430 core
+precision mediump float;
+layout (location = 0) in vec4 i_rect; // Pixels * VERTEX_POSITION_SCALE, relative to the anchor point
+layout (location = 1) in vec4 i_uv_rect;
+layout (location = 2) in vec4 i_colour;
+layout (location = 3) in float i_depth;
+layout (location = 4) in uint i_kind;
+layout (location = 5) in float i_width;
+layout (location = 6) in float i_corner_radius;
+layout (location = 7) in uvec4 i_insets;
+layout (location = 8) in uint i_anchor;
+out vec2 texcoord;
+out vec4 colour;
+out vec2 local_pos;
+flat out uint kind;
+flat out vec2 half_size;
+flat out float width;
+flat out float corner_radius;
+flat out vec4 insets;
+flat out vec4 uv_rect;
+
+uniform ivec2 resolution;
+uniform vec2 offset; // Pixels, moves scrolled content
+
+// Where every AnchorPoint is in the window, as a fraction of the resolution
+const vec2 anchor_factors[9] = vec2[9](
+    vec2(0.5, 0.5), // center
+    vec2(0.0, 0.0), // top left
+    vec2(0.5, 0.0), // top
+    vec2(1.0, 0.0), // top right
+    vec2(1.0, 0.5), // right
+    vec2(1.0, 1.0), // bottom right
+    vec2(0.5, 1.0), // bottom
+    vec2(0.0, 1.0), // bottom left
+    vec2(0.0, 0.5)  // left
+);
+
+#define KIND_RECT 0
+#define KIND_LINE 1
+#define KIND_ELLIPSE 2
+#define KIND_ELLIPSE_LINE 3
+#define KIND_ROUNDED_RECT 4
+#define KIND_ROUNDED_RECT_LINE 5
+#define KIND_CAPSULE 6
+#define KIND_NINE_SLICE 7
+#define KIND_LAYER 8
+
+// Extra space around the shapes for antialiasing
+#define AA_MARGIN 1.0
+
+void main()
+{
+    // Which corner of the quad this is, the quad is drawn as a triangle strip
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec4 rect = i_rect * (1.0 / 4.0);
+    width = i_width * (1.0 / 4.0);
+    corner_radius = i_corner_radius;
+    kind = i_kind;
+    insets = vec4(i_insets);
+    uv_rect = i_uv_rect;
+
+    vec2 pixel;
+    if (i_kind == KIND_LINE || i_kind == KIND_CAPSULE) {
+        // Lines are boxes in their own space, with the x-axis along the line
+        vec2 center = (rect.xy + rect.zw) * 0.5;
+        vec2 direction = rect.zw - rect.xy;
+        float line_length = length(direction);
+        direction = line_length > 0.0 ? direction / line_length : vec2(1, 0);
+        vec2 normal = vec2(-direction.y, direction.x);
+        half_size = vec2(line_length * 0.5, width);
+        if (i_kind == KIND_CAPSULE) {
+            half_size.x += width;
+            corner_radius = width;
+        }
+        local_pos = (corner * 2.0 - 1.0) * (half_size + AA_MARGIN);
+        pixel = center + direction * local_pos.x + normal * local_pos.y;
+    }
+    else {
+        // Outlines go outside of the shape too
+        half_size = (rect.zw - rect.xy) * 0.5;
+        float margin = 0.0;
+        if (i_kind != KIND_RECT && i_kind != KIND_NINE_SLICE && i_kind != KIND_LAYER) margin += AA_MARGIN;
+        if (i_kind == KIND_ELLIPSE_LINE || i_kind == KIND_ROUNDED_RECT_LINE) margin += width;
+        local_pos = (corner * 2.0 - 1.0) * (half_size + margin);
+        pixel = rect.xy + half_size + local_pos;
+    }
+
+    // Anchor points are rounded down to whole pixels, like Renderer::anchor_origin() does for culling and clipping
+    pixel += floor(anchor_factors[i_anchor] * vec2(resolution)) + offset;
+	gl_Position = vec4(pixel / vec2(resolution) * vec2(2, -2) + vec2(-1, 1), i_depth, 1);
+	texcoord = mix(i_uv_rect.xy, i_uv_rect.zw, corner);
+	colour = i_colour;
+}
\ No newline at end of file
@@ -1,28 +1,19 @@
-#version 330 core
+#version 430 core
 precision mediump float;
 
 out vec4 frag_color;
 in vec2 texcoord;
 in vec4 colour;
-in vec4 clip_rect;
 
 uniform sampler2D tex;
-uniform ivec2 resolution;
 
 void main()
 {
-    if (gl_FragCoord.x < clip_rect.x)
-        discard;
-    else if (gl_FragCoord.x > clip_rect.z)
-        discard;
-    else if ((resolution.y - gl_FragCoord.y) < clip_rect.y)
-        discard;
-    else if ((resolution.y - gl_FragCoord.y) > clip_rect.w)
-        discard;
+    // Output is premultiplied alpha
     if (colour.a != 0.0f)
-	    frag_color = colour;
+	    frag_color = vec4(colour.rgb * colour.a, colour.a);
     else {
-        if (texture(tex, texcoord).a == 0) discard;
-        frag_color = colour * texture(tex, texcoord);
+        vec4 texel = texture(tex, texcoord);
+        frag_color = vec4(colour.rgb * texel.rgb * texel.a, texel.a);
     }
 }
\ No newline at end of file
@@ -1,17 +1,34 @@
-#version 330 core
+#version 430 core
 precision mediump float;
-layout (location = 0) in vec3 i_position;
+layout (location = 0) in vec2 i_position; // Pixels * VERTEX_POSITION_SCALE, relative to the anchor point
 layout (location = 1) in vec2 i_texcoord;
 layout (location = 2) in vec4 i_colour;
-layout (location = 3) in vec4 i_clip_rect;
+layout (location = 3) in float i_depth;
+layout (location = 4) in uint i_anchor;
 out vec2 texcoord;
 out vec4 colour;
-out vec4 clip_rect;
+
+uniform ivec2 resolution;
+uniform vec2 offset; // Pixels, moves scrolled content
+
+// Where every AnchorPoint is in the window, as a fraction of the resolution
+const vec2 anchor_factors[9] = vec2[9](
+    vec2(0.5, 0.5), // center
+    vec2(0.0, 0.0), // top left
+    vec2(0.5, 0.0), // top
+    vec2(1.0, 0.0), // top right
+    vec2(1.0, 0.5), // right
+    vec2(1.0, 1.0), // bottom right
+    vec2(0.5, 1.0), // bottom
+    vec2(0.0, 1.0), // bottom left
+    vec2(0.0, 0.5)  // left
+);
 
 void main()
 {
-	gl_Position = vec4(i_position, 1);
+    // Anchor points are rounded down to whole pixels, like Renderer::anchor_origin() does for culling and clipping
+    vec2 pixel = i_position * (1.0 / 4.0) + floor(anchor_factors[i_anchor] * vec2(resolution)) + offset;
+	gl_Position = vec4(pixel / vec2(resolution) * vec2(2, -2) + vec2(-1, 1), i_depth, 1);
 	texcoord = i_texcoord;
 	colour = i_colour;
-    clip_rect = i_clip_rect;
 }
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <emmintrin.h>
+
+#include "glm/vec4.hpp"
+#include "RendererStructs.h"
+
+namespace Flan {
+    // SSE2 versions of the quantization helpers in RendererStructs.h, for the bulk draw functions.
+    // They round halfway cases to even instead of away from zero, so results can differ by a quarter of a pixel or one colour step.
+    // Define FLAN_SCALAR_PACKING to build the same functions on top of the scalar helpers instead, as the baseline FLAN_BENCH compares against
+#ifndef FLAN_SCALAR_PACKING
+
+    // Pixels to pixels * VERTEX_POSITION_SCALE, saturated to int16
+    inline __m128i quantize_positions_simd(const __m128 pixels) {
+        const __m128 scaled = _mm_mul_ps(pixels, _mm_set1_ps(VERTEX_POSITION_SCALE));
+        const __m128 clamped = _mm_min_ps(_mm_max_ps(scaled, _mm_set1_ps(static_cast<float>(INT16_MIN))), _mm_set1_ps(static_cast<float>(INT16_MAX)));
+        return _mm_cvtps_epi32(clamped);
+    }
+
+    // Four positions packed into the low 64 bits
+    inline __m128i pack_positions_simd(const __m128 pixels) {
+        const __m128i fixed = quantize_positions_simd(pixels);
+        return _mm_packs_epi32(fixed, fixed);
+    }
+
+    // Eight positions, a's four first
+    inline __m128i pack_positions_simd(const __m128 a, const __m128 b) {
+        return _mm_packs_epi32(quantize_positions_simd(a), quantize_positions_simd(b));
+    }
+
+    inline uint32_t pack_color_simd(const glm::vec4& color) {
+        const __m128 clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&color.x), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        const __m128i fixed = _mm_cvtps_epi32(_mm_mul_ps(clamped, _mm_set1_ps(255.0f)));
+        const __m128i words = _mm_packs_epi32(fixed, fixed);
+        return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(words, words)));
+    }
+
+    // Whether rect overlaps clip. Both are x0, y0, x1, y1
+    inline bool rect_visible_simd(const __m128 rect, const __m128 clip) {
+        const __m128 low = _mm_shuffle_ps(clip, rect, _MM_SHUFFLE(1, 0, 1, 0));  // clip x0, clip y0, rect x0, rect y0
+        const __m128 high = _mm_shuffle_ps(rect, clip, _MM_SHUFFLE(3, 2, 3, 2)); // rect x1, rect y1, clip x1, clip y1
+        return _mm_movemask_ps(_mm_cmplt_ps(low, high)) == 0xF;
+    }
+
+    // Bounding box x0, y0, x1, y1 of the two points x0, y0, x1, y1
+    inline __m128 points_bounds_simd(const __m128 points) {
+        const __m128 swapped = _mm_shuffle_ps(points, points, _MM_SHUFFLE(1, 0, 3, 2));
+        return _mm_shuffle_ps(_mm_min_ps(points, swapped), _mm_max_ps(points, swapped), _MM_SHUFFLE(3, 2, 1, 0));
+    }
+#else
+    // Scalar baseline, one lane at a time through pack_position() and pack_color(). Same results as drawing one primitive per call
+    inline __m128i quantize_positions_simd(const __m128 pixels) {
+        alignas(16) float p[4];
+        _mm_store_ps(p, pixels);
+        return _mm_setr_epi32(pack_position(p[0]), pack_position(p[1]), pack_position(p[2]), pack_position(p[3]));
+    }
+
+    inline __m128i pack_positions_simd(const __m128 pixels) {
+        alignas(16) float p[4];
+        _mm_store_ps(p, pixels);
+        return _mm_setr_epi16(pack_position(p[0]), pack_position(p[1]), pack_position(p[2]), pack_position(p[3]), 0, 0, 0, 0);
+    }
+
+    inline __m128i pack_positions_simd(const __m128 a, const __m128 b) {
+        alignas(16) float p[8];
+        _mm_store_ps(p, a);
+        _mm_store_ps(p + 4, b);
+        return _mm_setr_epi16(pack_position(p[0]), pack_position(p[1]), pack_position(p[2]), pack_position(p[3]),
+            pack_position(p[4]), pack_position(p[5]), pack_position(p[6]), pack_position(p[7]));
+    }
+
+    inline uint32_t pack_color_simd(const glm::vec4& color) {
+        return pack_color(color);
+    }
+
+    inline bool rect_visible_simd(const __m128 rect, const __m128 clip) {
+        alignas(16) float r[4];
+        alignas(16) float c[4];
+        _mm_store_ps(r, rect);
+        _mm_store_ps(c, clip);
+        return c[0] < r[2] && c[1] < r[3] && r[0] < c[2] && r[1] < c[3];
+    }
+
+    inline __m128 points_bounds_simd(const __m128 points) {
+        alignas(16) float p[4];
+        _mm_store_ps(p, points);
+        return _mm_setr_ps(glm::min(p[0], p[2]), glm::min(p[1], p[3]), glm::max(p[0], p[2]), glm::max(p[1], p[3]));
+    }
+#endif
+}
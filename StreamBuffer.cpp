@@ -0,0 +1,94 @@
+#include "StreamBuffer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <GL/gl3w.h>
+
+namespace Flan {
+    void StreamBuffer::init(const size_t section_size) {
+        create(section_size);
+        m_section = 0;
+        m_cursor = 0;
+    }
+
+    void StreamBuffer::create(const size_t section_size) {
+        m_section_size = section_size;
+
+        // Immutable storage that stays mapped for the lifetime of the buffer
+        constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const auto total_size = static_cast<GLsizeiptr>(m_section_size * STREAM_BUFFER_FRAMES);
+        glCreateBuffers(1, &m_id);
+        glNamedBufferStorage(m_id, total_size, nullptr, flags);
+        m_mapped = static_cast<uint8_t*>(glMapNamedBufferRange(m_id, 0, total_size, flags));
+        if (!m_mapped) {
+            printf("ERROR: Failed to map stream buffer!\n");
+        }
+    }
+
+    void StreamBuffer::destroy() {
+        for (auto& fence : m_fences) {
+            if (fence) glDeleteSync(fence);
+            fence = nullptr;
+        }
+        if (m_id) {
+            glUnmapNamedBuffer(m_id);
+            glDeleteBuffers(1, &m_id);
+        }
+        m_id = 0;
+        m_mapped = nullptr;
+    }
+
+    void StreamBuffer::begin_frame() {
+        m_section = (m_section + 1) % STREAM_BUFFER_FRAMES;
+        m_cursor = 0;
+
+        // Wait until the GPU is done with this section
+        GLsync& fence = m_fences[m_section];
+        if (fence) {
+            while (true) {
+                const GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000);
+                if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED) break;
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    void StreamBuffer::end_frame() {
+        GLsync& fence = m_fences[m_section];
+        if (fence) glDeleteSync(fence);
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    uint8_t* StreamBuffer::alloc(const size_t size, const size_t alignment, size_t& offset) {
+        offset = ((m_cursor + alignment - 1) / alignment) * alignment;
+        if (offset + size > m_section_size) {
+            grow(offset + size);
+        }
+        m_cursor = offset + size;
+        return m_mapped + section_offset() + offset;
+    }
+
+    void StreamBuffer::grow(const size_t min_section_size) {
+        // Keep the old buffer around so we can copy this frame's data over
+        const GLuint old_id = m_id;
+        const size_t old_offset = section_offset();
+        const size_t used = m_cursor;
+
+        // Create a new buffer that's at least twice as big. Fences belong to the old buffer, so they're no longer needed
+        for (auto& fence : m_fences) {
+            if (fence) glDeleteSync(fence);
+            fence = nullptr;
+        }
+        create(std::max(m_section_size * 2, min_section_size));
+        m_section = 0;
+
+        // Copy what we've written so far this frame on the GPU side, so offsets handed out earlier stay valid.
+        // OpenGL defers deleting the old buffer until the draw calls that use it are done.
+        if (used > 0) {
+            glCopyNamedBufferSubData(old_id, m_id, static_cast<GLintptr>(old_offset), 0, static_cast<GLsizeiptr>(used));
+        }
+        glUnmapNamedBuffer(old_id);
+        glDeleteBuffers(1, &old_id);
+    }
+}
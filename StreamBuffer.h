@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "GL/glcorearb.h"
+
+// Number of frames the CPU is allowed to run ahead of the GPU
+#define STREAM_BUFFER_FRAMES 3
+
+namespace Flan {
+    // Persistently mapped buffer for data that is regenerated every frame. The buffer is split into one section per frame
+    // in flight, and a fence per section makes sure we never write into memory the GPU is still reading from.
+    // It replaces the per-frame glBufferData calls, it doesn't save the copy: GLBackend fills it from the frame's CPU-side arrays
+    class StreamBuffer {
+    public:
+        void init(size_t section_size);
+        void destroy();
+
+        // Move to the next section, waiting for the GPU if it's still using it
+        void begin_frame();
+
+        // Place a fence after all the draw calls that use the current section
+        void end_frame();
+
+        // Allocate memory in the current section. The offset is relative to the start of the section, and is a multiple of the alignment.
+        // If the section is full, the buffer grows, in which case id() and section_offset() change, but earlier offsets stay valid.
+        [[nodiscard]] uint8_t* alloc(size_t size, size_t alignment, size_t& offset);
+
+        [[nodiscard]] GLuint id() const { return m_id; }
+        [[nodiscard]] size_t section_offset() const { return m_section * m_section_size; }
+        [[nodiscard]] size_t used() const { return m_cursor; }
+
+    private:
+        void create(size_t section_size);
+        void grow(size_t min_section_size);
+
+        GLuint m_id = 0;
+        uint8_t* m_mapped = nullptr;
+        size_t m_section_size = 0;
+        size_t m_section = 0;
+        size_t m_cursor = 0;
+        GLsync m_fences[STREAM_BUFFER_FRAMES]{};
+    };
+}
@@ -0,0 +1,123 @@
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <climits>
+
+#include "RenderBackend.h"
+
+// Empty space around every image, so sampling near the edge never picks up a neighbour
+#define ATLAS_PADDING 1
+
+namespace Flan {
+    void SkylinePacker::init(const int width, const int height) {
+        m_width = width;
+        m_height = height;
+        m_skyline.clear();
+        m_skyline.push_back({ 0, 0, width });
+    }
+
+    int SkylinePacker::fit(const size_t index, const glm::ivec2 size) const {
+        // Check if it fits horizontally
+        const int x = m_skyline[index].x;
+        if (x + size.x > m_width) return -1;
+
+        // Find the highest segment under the rectangle, that's where it has to be placed
+        int width_left = size.x;
+        int y = m_skyline[index].y;
+        for (size_t i = index; width_left > 0; ++i) {
+            y = std::max(y, m_skyline[i].y);
+            if (y + size.y > m_height) return -1;
+            width_left -= m_skyline[i].width;
+        }
+        return y;
+    }
+
+    void SkylinePacker::add(const size_t index, const glm::ivec2 pos, const glm::ivec2 size) {
+        // Insert the new segment
+        m_skyline.insert(m_skyline.begin() + static_cast<ptrdiff_t>(index), { pos.x, pos.y + size.y, size.x });
+
+        // Shrink or remove the segments that are now underneath it
+        for (size_t i = index + 1; i < m_skyline.size();) {
+            const Segment& prev = m_skyline[i - 1];
+            Segment& curr = m_skyline[i];
+            if (curr.x >= prev.x + prev.width) break;
+
+            const int shrink = prev.x + prev.width - curr.x;
+            curr.x += shrink;
+            curr.width -= shrink;
+            if (curr.width > 0) break;
+            m_skyline.erase(m_skyline.begin() + static_cast<ptrdiff_t>(i));
+        }
+
+        // Merge segments at the same height
+        for (size_t i = 0; i + 1 < m_skyline.size();) {
+            if (m_skyline[i].y == m_skyline[i + 1].y) {
+                m_skyline[i].width += m_skyline[i + 1].width;
+                m_skyline.erase(m_skyline.begin() + static_cast<ptrdiff_t>(i + 1));
+            }
+            else {
+                ++i;
+            }
+        }
+    }
+
+    bool SkylinePacker::pack(const glm::ivec2 size, glm::ivec2& pos) {
+        // Find the lowest spot, and if there are multiple, the leftmost one
+        int best_y = INT_MAX;
+        size_t best_index = SIZE_MAX;
+        for (size_t i = 0; i < m_skyline.size(); ++i) {
+            const int y = fit(i, size);
+            if (y >= 0 && y < best_y) {
+                best_y = y;
+                best_index = i;
+            }
+        }
+        if (best_index == SIZE_MAX) return false;
+
+        pos = { m_skyline[best_index].x, best_y };
+        add(best_index, pos, size);
+        return true;
+    }
+
+    void TextureAtlas::init(const int page_size, RenderBackend* backend) {
+        m_page_size = page_size;
+        m_backend = backend;
+    }
+
+    AtlasPage& TextureAtlas::new_page() {
+        AtlasPage& page = m_pages.emplace_back();
+        page.packer.init(m_page_size, m_page_size);
+
+        // Create an empty texture for the page. It starts out transparent, so the padding between images is too
+        page.texture = m_backend->create_texture({ m_page_size, m_page_size }, nullptr, false);
+        return page;
+    }
+
+    bool TextureAtlas::add(const uint8_t* pixels, const glm::ivec2 size, AtlasRegion& region) {
+        const glm::ivec2 padded_size = size + glm::ivec2(ATLAS_PADDING * 2);
+        if (padded_size.x > m_page_size || padded_size.y > m_page_size) return false;
+
+        // Find a page with room for it
+        glm::ivec2 pos{};
+        AtlasPage* page = nullptr;
+        for (auto& existing_page : m_pages) {
+            if (existing_page.packer.pack(padded_size, pos)) {
+                page = &existing_page;
+                break;
+            }
+        }
+        if (!page) {
+            page = &new_page();
+            if (!page->packer.pack(padded_size, pos)) return false;
+        }
+        pos += glm::ivec2(ATLAS_PADDING);
+
+        // Upload the pixels
+        m_backend->update_texture(page->texture, pos, size, pixels);
+
+        region.texture = page->texture;
+        region.uv_offset = glm::vec2(pos) / static_cast<float>(m_page_size);
+        region.uv_scale = glm::vec2(size) / static_cast<float>(m_page_size);
+        return true;
+    }
+}
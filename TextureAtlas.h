@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "GL/glcorearb.h"
+#include "glm/vec2.hpp"
+
+namespace Flan {
+    class RenderBackend;
+
+    // Packs rectangles into a fixed size area by keeping track of the "skyline" formed by the top edges of everything placed so far.
+    class SkylinePacker {
+    public:
+        void init(int width, int height);
+        bool pack(glm::ivec2 size, glm::ivec2& pos);
+
+    private:
+        struct Segment {
+            int x;
+            int y;
+            int width;
+        };
+        [[nodiscard]] int fit(size_t index, glm::ivec2 size) const;
+        void add(size_t index, glm::ivec2 pos, glm::ivec2 size);
+
+        std::vector<Segment> m_skyline;
+        int m_width = 0;
+        int m_height = 0;
+    };
+
+    struct AtlasPage {
+        GLuint texture = 0;
+        SkylinePacker packer;
+    };
+
+    // A location inside an atlas page
+    struct AtlasRegion {
+        GLuint texture;
+        glm::vec2 uv_offset;
+        glm::vec2 uv_scale;
+    };
+
+    // Runtime texture atlas. Images are packed into shared pages so that everything using them can be drawn in one batch.
+    class TextureAtlas {
+    public:
+        void init(int page_size, RenderBackend* backend); // Pages are created and updated through the backend
+        // Upload RGBA8 pixels into a page, creating a new page when the existing ones are full. Returns false if the image is larger than a page.
+        bool add(const uint8_t* pixels, glm::ivec2 size, AtlasRegion& region);
+        [[nodiscard]] size_t n_pages() const { return m_pages.size(); }
+
+    private:
+        AtlasPage& new_page();
+
+        std::vector<AtlasPage> m_pages;
+        int m_page_size = 0;
+        RenderBackend* m_backend = nullptr;
+    };
+}
@@ -0,0 +1,197 @@
+#include "ValueAutomation.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "ValueSystem.h"
+
+namespace Flan {
+    static void write_varint(std::vector<uint8_t>& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value) | 0x80);
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    static uint64_t read_varint(const uint8_t* data, size_t& offset) {
+        uint64_t value = 0;
+        int shift = 0;
+        while (data[offset] & 0x80) {
+            value |= static_cast<uint64_t>(data[offset++] & 0x7F) << shift;
+            shift += 7;
+        }
+        value |= static_cast<uint64_t>(data[offset++]) << shift;
+        return value;
+    }
+
+    AutomationTimeline::AutomationTimeline(const size_t max_bytes, const size_t chunk_size) {
+        m_max_bytes = max_bytes;
+        m_chunk_size = chunk_size;
+    }
+
+    void AutomationTimeline::begin_recording() {
+        m_record_start = std::chrono::steady_clock::now();
+        m_recording = true;
+    }
+
+    void AutomationTimeline::end_recording() {
+        m_recording = false;
+    }
+
+    void AutomationTimeline::clear() {
+        m_chunks.clear();
+        m_names.clear();
+        m_ids.clear();
+        m_record_prev.clear();
+        m_total_bytes = 0;
+        m_record_time = 0;
+        m_playing = false;
+    }
+
+    uint32_t AutomationTimeline::get_id(const std::string& name) {
+        const auto it = m_ids.find(name);
+        if (it != m_ids.end()) return it->second;
+
+        // New value, give it the next id
+        const auto id = static_cast<uint32_t>(m_names.size());
+        m_ids.emplace(name, id);
+        m_names.push_back(name);
+        m_record_prev.push_back(0);
+        return id;
+    }
+
+    void AutomationTimeline::start_chunk(const uint64_t time_us) {
+        // Make room by dropping the oldest chunks
+        while (!m_chunks.empty() && m_total_bytes + m_chunk_size > m_max_bytes) {
+            m_total_bytes -= m_chunks.front().data.capacity();
+            m_chunks.pop_front();
+
+            // If we were playing back the chunk that was just dropped, continue from the start of the next one
+            if (m_play_chunk > 0) {
+                --m_play_chunk;
+            }
+            else {
+                m_play_offset = 0;
+                std::fill(m_play_prev.begin(), m_play_prev.end(), 0);
+            }
+        }
+
+        AutomationChunk& chunk = m_chunks.emplace_back();
+        chunk.data.reserve(m_chunk_size + 32);
+        chunk.start_time_us = time_us;
+        chunk.end_time_us = time_us;
+        m_total_bytes += chunk.data.capacity();
+
+        // Every chunk starts from a clean state so it can be decoded without the ones before it
+        std::fill(m_record_prev.begin(), m_record_prev.end(), 0);
+        m_record_time = time_us;
+    }
+
+    void AutomationTimeline::record(const std::string& name, const uint64_t value) {
+        const auto now = std::chrono::steady_clock::now();
+        record(name, value, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now - m_record_start).count()));
+    }
+
+    void AutomationTimeline::record(const std::string& name, const uint64_t value, uint64_t time_us) {
+        if (!m_recording) return;
+
+        // Time can't go backwards within the timeline
+        time_us = std::max(time_us, m_record_time);
+
+        const uint32_t id = get_id(name);
+        if (m_chunks.empty() || m_chunks.back().data.size() >= m_chunk_size) {
+            start_chunk(time_us);
+        }
+        AutomationChunk& chunk = m_chunks.back();
+
+        // Time and id
+        write_varint(chunk.data, time_us - m_record_time);
+        write_varint(chunk.data, id);
+
+        // Value: XOR with the previous value, and strip the trailing zeros, which are very common for doubles
+        const uint64_t delta = value ^ m_record_prev[id];
+        const int trailing_zeros = std::countr_zero(delta);
+        chunk.data.push_back(static_cast<uint8_t>(trailing_zeros));
+        if (trailing_zeros < 64) {
+            write_varint(chunk.data, delta >> trailing_zeros);
+        }
+
+        m_record_prev[id] = value;
+        m_record_time = time_us;
+        chunk.end_time_us = time_us;
+        ++chunk.n_events;
+    }
+
+    void AutomationTimeline::begin_playback(ValuePool& pool) {
+        // Resolve every value slot once, so playback doesn't need any string lookups
+        m_play_slots.resize(m_names.size());
+        for (size_t i = 0; i < m_names.size(); ++i) {
+            m_play_slots[i] = &pool.values[m_names[i]];
+        }
+        m_play_prev.assign(m_names.size(), 0);
+        m_play_pool = &pool;
+        m_play_chunk = 0;
+        m_play_offset = 0;
+        m_play_time = m_chunks.empty() ? 0 : m_chunks.front().start_time_us;
+        m_playing = true;
+    }
+
+    size_t AutomationTimeline::update_playback(const uint64_t time_us) {
+        if (!m_playing) return 0;
+
+        // Values recorded after playback started don't have a slot yet
+        if (m_play_slots.size() < m_names.size()) {
+            m_play_slots.resize(m_names.size(), nullptr);
+            m_play_prev.resize(m_names.size(), 0);
+        }
+
+        size_t n_applied = 0;
+        while (m_play_chunk < m_chunks.size()) {
+            const AutomationChunk& chunk = m_chunks[m_play_chunk];
+            const uint8_t* data = chunk.data.data();
+
+            // Entering a new chunk resets the decoder state
+            if (m_play_offset == 0) {
+                m_play_time = chunk.start_time_us;
+                std::fill(m_play_prev.begin(), m_play_prev.end(), 0);
+            }
+
+            while (m_play_offset < chunk.data.size()) {
+                // Peek at the time, and stop if this event is in the future
+                size_t offset = m_play_offset;
+                const uint64_t event_time = m_play_time + read_varint(data, offset);
+                if (event_time > time_us) return n_applied;
+
+                // Decode the rest of the event
+                const auto id = static_cast<uint32_t>(read_varint(data, offset));
+                const int trailing_zeros = data[offset++];
+                uint64_t delta = 0;
+                if (trailing_zeros < 64) {
+                    delta = read_varint(data, offset) << trailing_zeros;
+                }
+                const uint64_t value = m_play_prev[id] ^ delta;
+                m_play_prev[id] = value;
+                m_play_time = event_time;
+                m_play_offset = offset;
+
+                // Write through the pool, so the change is shown and the Values bound to it are notified, but not recorded again
+                if (m_play_slots[id]) {
+                    m_play_pool->write(m_names[id], *m_play_slots[id], value, false);
+                    ++n_applied;
+                }
+            }
+
+            // Only move to the next chunk if this one is complete
+            if (m_play_chunk + 1 == m_chunks.size()) break;
+            ++m_play_chunk;
+            m_play_offset = 0;
+        }
+        return n_applied;
+    }
+
+    uint64_t AutomationTimeline::duration_us() const {
+        if (m_chunks.empty()) return 0;
+        return m_chunks.back().end_time_us - m_chunks.front().start_time_us;
+    }
+}
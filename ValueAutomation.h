@@ -0,0 +1,72 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Flan {
+    struct ValuePool;
+
+    // A block of encoded automation events. Every chunk can be decoded on its own, so when the timeline runs out of
+    // memory the oldest chunk can simply be dropped.
+    struct AutomationChunk {
+        std::vector<uint8_t> data;
+        uint64_t start_time_us = 0; // Time of the first event, every event stores the delta to the previous one
+        uint64_t end_time_us = 0;
+        uint32_t n_events = 0;
+    };
+
+    // Records timestamped value changes into a compressed timeline and plays them back into a value pool.
+    // Each event is stored as varint(time delta), varint(value id) and the value XOR'd with the previous value of the same
+    // id, with its trailing zeros stripped, which makes slowly changing values take 2-4 bytes per event.
+    class AutomationTimeline {
+    public:
+        explicit AutomationTimeline(size_t max_bytes = 16ull * 1024 * 1024, size_t chunk_size = 64ull * 1024);
+
+        //---Recording---
+        void begin_recording();
+        void end_recording();
+        void clear();
+        void record(const std::string& name, uint64_t value); // Uses the time since begin_recording()
+        void record(const std::string& name, uint64_t value, uint64_t time_us);
+        [[nodiscard]] bool is_recording() const { return m_recording; }
+
+        //---Playback---
+        void begin_playback(ValuePool& pool);
+        // Apply every event up to the given time since the start of the recording. Returns the number of values written.
+        size_t update_playback(uint64_t time_us);
+        [[nodiscard]] bool is_playing() const { return m_playing; }
+
+        [[nodiscard]] uint64_t duration_us() const;
+        [[nodiscard]] size_t memory_usage() const { return m_total_bytes; }
+        [[nodiscard]] size_t n_chunks() const { return m_chunks.size(); }
+
+    private:
+        uint32_t get_id(const std::string& name);
+        void start_chunk(uint64_t time_us);
+
+        std::deque<AutomationChunk> m_chunks;
+        std::vector<std::string> m_names;
+        std::map<std::string, uint32_t> m_ids;
+        size_t m_max_bytes;
+        size_t m_chunk_size;
+        size_t m_total_bytes = 0;
+
+        // Recording state
+        std::chrono::steady_clock::time_point m_record_start{};
+        std::vector<uint64_t> m_record_prev; // Previous value per id, reset at the start of every chunk
+        uint64_t m_record_time = 0;
+        bool m_recording = false;
+
+        // Playback state
+        ValuePool* m_play_pool = nullptr;
+        std::vector<uint64_t*> m_play_slots;
+        std::vector<uint64_t> m_play_prev;
+        size_t m_play_chunk = 0;
+        size_t m_play_offset = 0;
+        uint64_t m_play_time = 0;
+        bool m_playing = false;
+    };
+}
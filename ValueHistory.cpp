@@ -0,0 +1,35 @@
+#include "ValueHistory.h"
+
+#include "ValueSystem.h"
+
+namespace Flan {
+    size_t ValueHistory::undo(ValuePool& pool) {
+        if (m_end == m_begin) return 0;
+        m_applying = true;
+        size_t n_restored = 0;
+        const uint32_t gesture = at(m_end - 1).gesture;
+        while (m_end > m_begin && at(m_end - 1).gesture == gesture) {
+            const Delta& delta = at(m_end - 1);
+            pool.write(*delta.name, *delta.slot, delta.old_value);
+            --m_end;
+            ++n_restored;
+        }
+        m_applying = false;
+        return n_restored;
+    }
+
+    size_t ValueHistory::redo(ValuePool& pool) {
+        if (m_end == m_redo_end) return 0;
+        m_applying = true;
+        size_t n_restored = 0;
+        const uint32_t gesture = at(m_end).gesture;
+        while (m_end < m_redo_end && at(m_end).gesture == gesture) {
+            const Delta& delta = at(m_end);
+            pool.write(*delta.name, *delta.slot, delta.new_value);
+            ++m_end;
+            ++n_restored;
+        }
+        m_applying = false;
+        return n_restored;
+    }
+}
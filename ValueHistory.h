@@ -0,0 +1,110 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+
+#define VALUE_HISTORY_SIZE 4096
+
+namespace Flan {
+    struct ValuePool;
+
+    // Undo/redo history for the value pool. Instead of copying the pool, every change is stored as a delta on the value's
+    // slot in a fixed size ring buffer, and everything between begin_gesture() and end_gesture() becomes one undo step.
+    // The slots and names are pointers into the pool's map, which stay valid since values are never removed from the pool.
+    class ValueHistory {
+    public:
+        // Start a new undo step. Repeated changes to the same value inside a gesture are merged into one delta.
+        void begin_gesture() {
+            m_current_gesture = ++m_gesture_counter;
+            m_in_gesture = true;
+        }
+
+        void end_gesture() {
+            m_in_gesture = false;
+        }
+
+        // Record a change to a value. Changes made outside a gesture are their own undo step.
+        void record(const std::string* name, uint64_t* slot, const uint64_t old_value, const uint64_t new_value) {
+            // Don't record the changes we make ourselves while undoing or redoing
+            if (m_applying || old_value == new_value) return;
+
+            // Any new change invalidates the redo history
+            m_redo_end = m_end;
+
+            const uint32_t gesture = m_in_gesture ? m_current_gesture : ++m_gesture_counter;
+            if (gesture == m_dropped_gesture) return;
+
+            // If this value was already changed during this gesture, merge the deltas. Only look back a few entries
+            // so big gestures (like applying a preset) don't become quadratic - a missed merge only costs a slot.
+            if (m_in_gesture) {
+                for (uint64_t i = m_end; i > m_begin && m_end - i < 16; --i) {
+                    Delta& delta = at(i - 1);
+                    if (delta.gesture != gesture) break;
+                    if (delta.slot == slot) {
+                        delta.new_value = new_value;
+                        return;
+                    }
+                }
+            }
+
+            // If the buffer is full, drop the entire oldest gesture so we never leave a half undo step behind
+            if (m_end - m_begin == VALUE_HISTORY_SIZE) {
+                const uint32_t oldest_gesture = at(m_begin).gesture;
+
+                // If that's the one being recorded, it doesn't fit at all. Undoing part of it would be wrong, so drop it and ignore the rest of it
+                if (oldest_gesture == gesture) {
+                    m_begin = m_end;
+                    m_redo_end = m_end;
+                    m_dropped_gesture = gesture;
+                    return;
+                }
+                while (m_begin < m_end && at(m_begin).gesture == oldest_gesture) {
+                    ++m_begin;
+                }
+            }
+
+            at(m_end) = { name, slot, old_value, new_value, gesture };
+            ++m_end;
+            m_redo_end = m_end;
+        }
+
+        // Revert the most recent undo step. Values are restored through the pool, so everything that watches them sees the change,
+        // but it isn't recorded as a new one. Returns the number of values that were restored.
+        size_t undo(ValuePool& pool);
+
+        // Re-apply the most recently undone step. Returns the number of values that were restored.
+        size_t redo(ValuePool& pool);
+
+        void clear() {
+            m_begin = 0;
+            m_end = 0;
+            m_redo_end = 0;
+        }
+
+        [[nodiscard]] bool in_gesture() const { return m_in_gesture; }
+        [[nodiscard]] bool can_undo() const { return m_end != m_begin; }
+        [[nodiscard]] bool can_redo() const { return m_end != m_redo_end; }
+
+    private:
+        struct Delta {
+            const std::string* name; // The pool's key, so undoing can notify without looking it up
+            uint64_t* slot;
+            uint64_t old_value;
+            uint64_t new_value;
+            uint32_t gesture;
+        };
+
+        Delta& at(const uint64_t index) { return m_deltas[index % VALUE_HISTORY_SIZE]; }
+
+        std::array<Delta, VALUE_HISTORY_SIZE> m_deltas{};
+        // These only ever count up, the ring buffer index is derived from them
+        uint64_t m_begin = 0;
+        uint64_t m_end = 0;
+        uint64_t m_redo_end = 0;
+        uint32_t m_gesture_counter = 0;
+        uint32_t m_current_gesture = 0;
+        uint32_t m_dropped_gesture = 0; // Gesture that overflowed the buffer, 0 is never used
+        bool m_in_gesture = false;
+        bool m_applying = false;
+    };
+}
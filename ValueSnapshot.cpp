@@ -0,0 +1,250 @@
+#include "ValueSnapshot.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string_view>
+#include <Windows.h>
+
+namespace Flan {
+    ValueSnapshot::~ValueSnapshot() {
+        release();
+    }
+
+    ValueSnapshot::ValueSnapshot(ValueSnapshot&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    ValueSnapshot& ValueSnapshot::operator=(ValueSnapshot&& other) noexcept {
+        if (this == &other) return *this;
+        release();
+        m_storage = std::move(other.m_storage);
+        m_data = other.m_data;
+        m_size = other.m_size;
+        m_file = other.m_file;
+        m_mapping = other.m_mapping;
+        other.m_data = nullptr;
+        other.m_size = 0;
+        other.m_file = nullptr;
+        other.m_mapping = nullptr;
+        return *this;
+    }
+
+    void ValueSnapshot::release() {
+        // Unmap the file if we were using one
+        if (m_mapping) {
+            UnmapViewOfFile(m_data);
+            CloseHandle(m_mapping);
+        }
+        if (m_file) {
+            CloseHandle(m_file);
+        }
+        m_storage.clear();
+        m_data = nullptr;
+        m_size = 0;
+        m_file = nullptr;
+        m_mapping = nullptr;
+    }
+
+    ValueSnapshot ValueSnapshot::build(const std::vector<std::pair<const std::string*, uint64_t>>& entries, const uint16_t flags) {
+        // Calculate the size of the name blob
+        size_t names_size = 0;
+        for (const auto& [name, value] : entries) {
+            names_size += name->size();
+        }
+
+        // Allocate the whole snapshot at once
+        ValueSnapshot snapshot;
+        const size_t names_offset = sizeof(SnapshotHeader) + entries.size() * sizeof(SnapshotEntry);
+        snapshot.m_storage.resize(names_offset + names_size);
+        uint8_t* data = snapshot.m_storage.data();
+
+        // Fill in the header
+        SnapshotHeader header{};
+        header.magic = SNAPSHOT_MAGIC;
+        header.version = SNAPSHOT_VERSION;
+        header.flags = flags;
+        header.n_entries = static_cast<uint32_t>(entries.size());
+        header.names_offset = static_cast<uint32_t>(names_offset);
+        header.names_size = static_cast<uint32_t>(names_size);
+        memcpy(data, &header, sizeof(header));
+
+        // Fill in the entries and the names. The input is already sorted, since it comes from the pool's map
+        auto* entry_out = reinterpret_cast<SnapshotEntry*>(data + sizeof(SnapshotHeader));
+        char* name_out = reinterpret_cast<char*>(data + names_offset);
+        uint32_t name_cursor = 0;
+        for (const auto& [name, value] : entries) {
+            *entry_out++ = { name_cursor, static_cast<uint32_t>(name->size()), value };
+            memcpy(name_out + name_cursor, name->data(), name->size());
+            name_cursor += static_cast<uint32_t>(name->size());
+        }
+
+        snapshot.m_data = data;
+        snapshot.m_size = snapshot.m_storage.size();
+        return snapshot;
+    }
+
+    ValueSnapshot ValueSnapshot::capture(const ValuePool& pool) {
+        std::vector<std::pair<const std::string*, uint64_t>> entries;
+        entries.reserve(pool.values.size());
+        for (const auto& [name, value] : pool.values) {
+            if (pool.is_pointer(name)) continue;
+            entries.emplace_back(&name, value);
+        }
+        return build(entries, 0);
+    }
+
+    ValueSnapshot ValueSnapshot::capture_delta(const ValuePool& pool, const ValueSnapshot& base) {
+        std::vector<std::pair<const std::string*, uint64_t>> entries;
+
+        // Walk both sorted lists at the same time
+        const SnapshotEntry* base_entries = base.is_valid() ? base.entries() : nullptr;
+        const size_t n_base = base.n_entries();
+        size_t base_index = 0;
+        for (const auto& [name, value] : pool.values) {
+            if (pool.is_pointer(name)) continue;
+
+            // Skip base entries that come before this name
+            while (base_index < n_base && std::string_view(base.names() + base_entries[base_index].name_offset, base_entries[base_index].name_length) < name) {
+                ++base_index;
+            }
+
+            // Only store the value if it's new, or if it differs from the base
+            if (base_index < n_base && std::string_view(base.names() + base_entries[base_index].name_offset, base_entries[base_index].name_length) == name) {
+                if (base_entries[base_index].value != value) {
+                    entries.emplace_back(&name, value);
+                }
+                ++base_index;
+                continue;
+            }
+            entries.emplace_back(&name, value);
+        }
+        return build(entries, SNAPSHOT_FLAG_DELTA);
+    }
+
+    size_t ValueSnapshot::apply(ValuePool& pool) const {
+        if (!is_valid()) return 0;
+
+        const SnapshotEntry* entry = entries();
+        const char* name_blob = names();
+        const size_t n = header().n_entries;
+        size_t n_changed = 0;
+
+        // Small deltas are cheaper to look up one by one than to walk the entire pool
+        const bool walk_pool = n * 8 >= pool.values.size();
+
+        // The whole preset is one undo step, unless it's part of a gesture that's already open
+        ValueHistory* history = pool.history && !pool.history->in_gesture() ? pool.history : nullptr;
+        if (history) history->begin_gesture();
+
+        auto it = pool.values.begin();
+        for (size_t i = 0; i < n; ++i, ++entry) {
+            const std::string_view name(name_blob + entry->name_offset, entry->name_length);
+
+            // Older snapshots, or ones from another build, can still have an address for what is now a pointer slot
+            if (pool.is_pointer(name)) continue;
+            if (walk_pool) {
+                while (it != pool.values.end() && std::string_view(it->first) < name) ++it;
+            }
+            else {
+                it = pool.values.lower_bound(name);
+            }
+
+            // Existing value, only write it if it changed
+            if (it != pool.values.end() && std::string_view(it->first) == name) {
+                if (it->second != entry->value) {
+                    pool.write(it->first, it->second, entry->value);
+                    ++n_changed;
+                }
+                ++it;
+                continue;
+            }
+
+            // New value, the iterator is already at the right spot so insertion is amortized constant time
+            it = pool.values.emplace_hint(it, std::string(name), 0);
+            pool.write(it->first, it->second, entry->value);
+            ++it;
+            ++n_changed;
+        }
+        if (history) history->end_gesture();
+        return n_changed;
+    }
+
+    bool ValueSnapshot::validate() const {
+        // Check the header
+        if (m_size < sizeof(SnapshotHeader)) return false;
+        const SnapshotHeader& head = header();
+        if (head.magic != SNAPSHOT_MAGIC || head.version != SNAPSHOT_VERSION) return false;
+        if (head.names_offset != sizeof(SnapshotHeader) + static_cast<size_t>(head.n_entries) * sizeof(SnapshotEntry)) return false;
+        if (static_cast<size_t>(head.names_offset) + head.names_size > m_size) return false;
+
+        // Check that every name is in bounds and that the entries are sorted, since apply() depends on that
+        const SnapshotEntry* entry = entries();
+        std::string_view prev_name;
+        for (uint32_t i = 0; i < head.n_entries; ++i) {
+            if (static_cast<size_t>(entry[i].name_offset) + entry[i].name_length > head.names_size) return false;
+            const std::string_view name(names() + entry[i].name_offset, entry[i].name_length);
+            if (i > 0 && !(prev_name < name)) return false;
+            prev_name = name;
+        }
+        return true;
+    }
+
+    bool ValueSnapshot::load_from_memory(const uint8_t* data, const size_t size) {
+        release();
+        m_storage.assign(data, data + size);
+        m_data = m_storage.data();
+        m_size = m_storage.size();
+        if (!validate()) {
+            printf("ERROR: Invalid value snapshot!\n");
+            release();
+            return false;
+        }
+        return true;
+    }
+
+    bool ValueSnapshot::load_from_file(const std::string& path) {
+        release();
+
+        // Open the file
+        const HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            printf("ERROR: Unable to open value snapshot '%s'\n", path.c_str());
+            return false;
+        }
+        m_file = file;
+
+        // Get size
+        LARGE_INTEGER file_size{};
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+            printf("ERROR: Unable to read value snapshot '%s'\n", path.c_str());
+            release();
+            return false;
+        }
+
+        // Map it into memory
+        m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!m_mapping) {
+            printf("ERROR: Unable to map value snapshot '%s'\n", path.c_str());
+            release();
+            return false;
+        }
+        m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        m_size = static_cast<size_t>(file_size.QuadPart);
+        if (!m_data || !validate()) {
+            printf("ERROR: Invalid value snapshot '%s'\n", path.c_str());
+            release();
+            return false;
+        }
+        return true;
+    }
+
+    bool ValueSnapshot::save_to_file(const std::string& path) const {
+        if (!is_valid()) return false;
+
+        std::ofstream file;
+        file.open(path.c_str(), std::ios::binary | std::ios::out);
+        if (file.good() == false) return false;
+        file.write(reinterpret_cast<const char*>(m_data), static_cast<std::streamsize>(m_size));
+        return file.good();
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ValueSystem.h"
+
+namespace Flan {
+    constexpr uint32_t SNAPSHOT_MAGIC = 0x53564C46; // "FLVS"
+    constexpr uint16_t SNAPSHOT_VERSION = 1;
+    constexpr uint16_t SNAPSHOT_FLAG_DELTA = 1 << 0;
+
+    // Snapshot layout: header, entry table sorted by name, then one blob with all the names.
+    // Everything is fixed size and offset based, so a memory mapped file can be used as-is.
+    struct SnapshotHeader {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t flags;
+        uint32_t n_entries;
+        uint32_t names_offset; // Relative to the start of the snapshot
+        uint32_t names_size;
+        uint32_t reserved;
+    };
+
+    struct SnapshotEntry {
+        uint32_t name_offset; // Relative to the start of the name blob
+        uint32_t name_length;
+        uint64_t value;
+    };
+
+    // A frozen copy of (part of) a value pool, used for presets and A/B switching.
+    // Values set with set_ptr() are left out when capturing and when applying, since a stored address would dangle in another run.
+    class ValueSnapshot {
+    public:
+        ValueSnapshot() = default;
+        ~ValueSnapshot();
+        ValueSnapshot(const ValueSnapshot&) = delete;
+        ValueSnapshot& operator=(const ValueSnapshot&) = delete;
+        ValueSnapshot(ValueSnapshot&& other) noexcept;
+        ValueSnapshot& operator=(ValueSnapshot&& other) noexcept;
+
+        // Store every value in the pool
+        static ValueSnapshot capture(const ValuePool& pool);
+
+        // Only store the values that were added or changed compared to the base snapshot
+        static ValueSnapshot capture_delta(const ValuePool& pool, const ValueSnapshot& base);
+
+        // Write the values in this snapshot to the pool in one sorted pass. Returns the number of values that actually changed.
+        // Changes are reported to the pool's history as one undo step, or as part of the gesture that's open.
+        size_t apply(ValuePool& pool) const;
+
+        //---File IO---
+        bool load_from_memory(const uint8_t* data, size_t size);
+        bool load_from_file(const std::string& path); // Memory maps the file, it stays mapped until the snapshot is destroyed
+        [[nodiscard]] bool save_to_file(const std::string& path) const;
+
+        [[nodiscard]] bool is_valid() const { return m_data != nullptr; }
+        [[nodiscard]] bool is_delta() const { return is_valid() && (header().flags & SNAPSHOT_FLAG_DELTA); }
+        [[nodiscard]] size_t n_entries() const { return is_valid() ? header().n_entries : 0; }
+        [[nodiscard]] const uint8_t* data() const { return m_data; }
+        [[nodiscard]] size_t size() const { return m_size; }
+
+    private:
+        static ValueSnapshot build(const std::vector<std::pair<const std::string*, uint64_t>>& entries, uint16_t flags);
+        bool validate() const;
+        void release();
+        [[nodiscard]] const SnapshotHeader& header() const { return *reinterpret_cast<const SnapshotHeader*>(m_data); }
+        [[nodiscard]] const SnapshotEntry* entries() const { return reinterpret_cast<const SnapshotEntry*>(m_data + sizeof(SnapshotHeader)); }
+        [[nodiscard]] const char* names() const { return reinterpret_cast<const char*>(m_data + header().names_offset); }
+
+        std::vector<uint8_t> m_storage; // Owned data, empty when the snapshot is memory mapped
+        const uint8_t* m_data = nullptr;
+        size_t m_size = 0;
+        void* m_file = nullptr;
+        void* m_mapping = nullptr;
+    };
+}
@@ -1,30 +1,90 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <map>
+#include <set>
+#include <vector>
+
+#include "AllocationTracker.h"
+#include "ValueAutomation.h"
+#include "ValueHistory.h"
 #define N_VALUES 256
 
 namespace Flan {
+    // Not thread safe. Values are only read and changed on the main thread, which is also where update_entities() turns changes into new frames
     struct ValuePool {
-        std::map<std::string, uint64_t> values;
+        std::map<std::string, uint64_t, std::less<>> values; // Transparent comparator, so lookups by name don't have to build a std::string
+        std::set<std::string, std::less<>> pointer_names;     // Values set with set_ptr(). Their slots hold addresses that mean nothing outside this process
+
+        // Optional undo history and automation recording, every change made through Value gets recorded into them
+        ValueHistory* history = nullptr;
+        AutomationTimeline* automation = nullptr;
+
+        // Set whenever a change is announced through notify_change(), update_entities() clears it and requests a frame to show it
+        bool changed = false;
+
+        // Slots changed through write() since the last update_entities(), which sets has_changed on the Values bound to them
+        std::vector<const uint64_t*> written_slots;
+
+        // Get the slot of a name, creating it if it doesn't exist yet. Only creating one allocates
+        uint64_t& slot(const std::string_view name) {
+            const auto it = values.find(name);
+            if (it != values.end()) return it->second;
+            AllocationScope scope(AllocSubsystem::values);
+            return values.emplace(std::string(name), 0).first->second;
+        }
+
+        // The pool's own copy of a name, which lives as long as the pool. notify_change() needs this one
+        const std::string& key(const std::string_view name) {
+            slot(name);
+            return values.find(name)->first;
+        }
 
         // Get value from name
         template<typename T>
-        T& get(const std::string& name) {
+        T& get(const std::string_view name) {
             static_assert(sizeof(T) <= sizeof(uint64_t));
-            return reinterpret_cast<T&>(values[name]);
+            return reinterpret_cast<T&>(slot(name));
         }
 
         // Set the current value
         template<typename T>
-        void set_value(const std::string& name, T value) {
+        void set_value(const std::string_view name, T value) {
             static_assert(sizeof(T) <= sizeof(uint64_t));
-            values[name] = *reinterpret_cast<uint64_t*>(&value);
+            slot(name) = *reinterpret_cast<uint64_t*>(&value);
         }
 
-        // Set the current pointer
+        // Set the current pointer. The slot is marked as a pointer, so snapshots leave it out
         template<typename T>
-        void set_ptr(const std::string& name, T* value) {
-            values[name] = reinterpret_cast<uint64_t>(value);
+        void set_ptr(const std::string_view name, T* value) {
+            slot(name) = reinterpret_cast<uint64_t>(value);
+            if (!pointer_names.contains(name)) {
+                AllocationScope scope(AllocSubsystem::values);
+                pointer_names.emplace(name);
+            }
+        }
+
+        [[nodiscard]] bool is_pointer(const std::string_view name) const { return pointer_names.contains(name); }
+
+        // Let the listeners know that a value slot was changed. The name has to be the pool's own key, the history keeps a pointer to it
+        void notify_change(const std::string& name, uint64_t& slot, const uint64_t old_value) {
+            changed = true;
+            if (history) history->record(&name, &slot, old_value, slot);
+            if (automation) automation->record(name, slot);
+        }
+
+        // Change a slot from outside Value::set(), like undo, presets and automation playback do, and let the listeners know. The name is the pool's key.
+        // Playback passes record = false, so it doesn't end up in the history or the timeline it's playing from
+        void write(const std::string& name, uint64_t& slot, const uint64_t value, const bool record = true) {
+            if (slot == value) return;
+            const uint64_t old_value = slot;
+            slot = value;
+            {
+                AllocationScope scope(AllocSubsystem::values);
+                written_slots.push_back(&slot);
+            }
+            if (record) notify_change(name, slot, old_value);
+            else changed = true;
         }
     };
 
@@ -67,8 +127,14 @@ namespace Flan {
         template<typename T>
         void set(T value) {
             static_assert(sizeof(T) <= sizeof(uint64_t));
-            if (get_as_ref<T>() != static_cast<T>(value)) has_changed = true;
-            get_as_ref<T>() = static_cast<T>(value);
+            const auto it = value_pool.values.try_emplace(name).first;
+            uint64_t& slot = it->second;
+            T& current = reinterpret_cast<T&>(slot);
+            if (current == static_cast<T>(value)) return;
+            const uint64_t old_value = slot;
+            current = static_cast<T>(value);
+            has_changed = true;
+            value_pool.notify_change(it->first, slot, old_value);
         }
     };
 }
\ No newline at end of file